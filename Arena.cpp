@@ -0,0 +1,61 @@
+/* Arena.cpp
+Michael Zahniser, 17 Oct 2026
+*/
+
+#include "Arena.h"
+
+#include <cstring>
+
+using namespace std;
+
+namespace {
+	// The normal size of a block. Text longer than this gets a block of its own.
+	const size_t BLOCK_SIZE = 65536;
+}
+
+
+
+// Copy the given text into the arena, and return a view of the copy.
+string_view Arena::Copy(string_view text)
+{
+	if(text.empty())
+		return string_view();
+	
+	// Start a new block if the text does not fit in the current one.
+	if(blocks.empty() || used + text.size() > sizes.back())
+	{
+		size_t size = max(BLOCK_SIZE, text.size());
+		blocks.emplace_back(new char[size]);
+		sizes.push_back(size);
+		used = 0;
+	}
+	
+	char *copy = blocks.back().get() + used;
+	memcpy(copy, text.data(), text.size());
+	used += text.size();
+	return string_view(copy, text.size());
+}
+
+
+
+// Free everything stored in the arena.
+void Arena::Clear()
+{
+	if(blocks.size() > 1)
+	{
+		blocks.resize(1);
+		sizes.resize(1);
+	}
+	used = 0;
+}
+
+
+
+// Get the number of bytes of memory the arena has allocated for text.
+size_t Arena::Capacity() const
+{
+	size_t capacity = 0;
+	for(size_t size : sizes)
+		capacity += size;
+	return capacity;
+}
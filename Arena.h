@@ -0,0 +1,41 @@
+/* Arena.h
+Michael Zahniser, 17 Oct 2026
+
+Class for storing a large number of strings that are all freed at once. Text is
+copied into large blocks of memory, and copies are never moved or freed until
+the whole arena is cleared, so views of them remain valid until then.
+*/
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+
+
+class Arena {
+public:
+	// Copy the given text into the arena, and return a view of the copy.
+	string_view Copy(string_view text);
+	// Free everything stored in the arena. The first block is kept so that it
+	// can be reused.
+	void Clear();
+	
+	// Get the number of bytes of memory the arena has allocated for text.
+	size_t Capacity() const;
+	
+	
+private:
+	vector<unique_ptr<char[]>> blocks;
+	vector<size_t> sizes;
+	// How much of the last block has been used.
+	size_t used = 0;
+};
+
+
+
+#endif
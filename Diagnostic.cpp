@@ -0,0 +1,114 @@
+/* Diagnostic.cpp
+Michael Zahniser, 17 Oct 2026
+*/
+
+#include "Diagnostic.h"
+
+#include <cstring>
+
+using namespace std;
+
+namespace {
+	// Tags that mark what type of message a line is. Each one is looked for
+	// right after a ':'. Linker errors are ignored ("collect2: error: ld
+	// returned 1 exit status"), because "undefined reference" lines are more
+	// useful, so that tag must be checked before the plain error tag. Notes
+	// are not messages, but belong to the message before them.
+	class Tag {
+	public:
+		string_view text;
+		Message::Type type;
+	};
+	const Tag TAGS[] = {
+		{" error: ld returned", Message::NONE},
+		{" error: ", Message::ERROR},
+		{" fatal error: ", Message::ERROR},
+		{" warning: ", Message::WARNING},
+		{" note: ", Message::NONE},
+		{" undefined reference", Message::LINK}
+	};
+	
+	// Parse a number starting at the given position. If there is no number
+	// there, return -1. Otherwise, advance the position past the number.
+	int ParseNumber(string_view text, size_t &pos)
+	{
+		if(pos >= text.size() || text[pos] < '0' || text[pos] > '9')
+			return -1;
+		
+		int value = 0;
+		for( ; pos < text.size() && text[pos] >= '0' && text[pos] <= '9'; ++pos)
+			value = value * 10 + (text[pos] - '0');
+		return value;
+	}
+}
+
+
+
+// Parse the given line. If it is not an error, warning, or link error, this
+// returns false, and the type is set to Message::NONE.
+bool Diagnostic::Parse(string_view line)
+{
+	text = line;
+	type = Message::NONE;
+	file = string_view();
+	this->line = -1;
+	column = -1;
+	body = string_view();
+	isNote = false;
+	
+	// The file name runs up to the first ':'. Some link errors do not list a
+	// file; they start with '('. memchr() is used for all the searching because
+	// the C library implements it with vector instructions.
+	const char *begin = text.data();
+	const char *end = begin + text.size();
+	const char *colon = static_cast<const char *>(memchr(begin, ':', text.size()));
+	if(!colon)
+		return false;
+	if(*begin != '(')
+		file = string_view(begin, colon - begin);
+	
+	// Next there may be a line number, and then a column number.
+	size_t pos = colon - begin + 1;
+	this->line = ParseNumber(text, pos);
+	if(this->line >= 0 && pos < text.size() && text[pos] == ':')
+	{
+		++pos;
+		column = ParseNumber(text, pos);
+	}
+	
+	// Check each remaining ':' for a tag saying what type of message this is.
+	for( ; colon; colon = static_cast<const char *>(memchr(colon + 1, ':', end - colon - 1)))
+	{
+		string_view rest(colon + 1, end - colon - 1);
+		// All the tags start with a space, and are told apart by the letter
+		// after that, so most colons are rejected after one or two comparisons.
+		if(rest.size() < 2 || rest[0] != ' ')
+			continue;
+		
+		for(const Tag &tag : TAGS)
+		{
+			if(rest[1] != tag.text[1] || rest.compare(0, tag.text.size(), tag.text))
+				continue;
+			
+			type = tag.type;
+			body = rest.substr(tag.text.size());
+			if(type == Message::NONE)
+			{
+				isNote = (tag.text[1] == 'n');
+				return false;
+			}
+			
+			// Link errors refer to a file, but not to a particular line in it.
+			if(type == Message::LINK)
+			{
+				this->line = -1;
+				column = -1;
+			}
+			return true;
+		}
+	}
+	
+	this->line = -1;
+	column = -1;
+	return false;
+}
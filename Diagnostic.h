@@ -0,0 +1,45 @@
+/* Diagnostic.h
+Michael Zahniser, 17 Oct 2026
+
+Class for breaking a line of compiler or linker output into its parts: the file
+and position it refers to, what type of message it is, and the message itself.
+Everything is found in a single pass over the line.
+*/
+
+#ifndef DIAGNOSTIC_H_
+#define DIAGNOSTIC_H_
+
+#include "Message.h"
+
+#include <string_view>
+
+using namespace std;
+
+
+
+class Diagnostic {
+public:
+	// Parse the given line. If it is not an error, warning, or link error, this
+	// returns false, and the type is set to Message::NONE. A note is not a
+	// message in its own right, so this returns false for it too, but it is
+	// flagged as a note, and its file and position are filled in.
+	bool Parse(string_view line);
+	
+	
+public:
+	// The whole line that was parsed.
+	string_view text;
+	Message::Type type = Message::NONE;
+	// The file the message refers to (if any) and the position within it. If
+	// there is no line or column number, they are set to -1.
+	string_view file;
+	int line = -1;
+	int column = -1;
+	// The text of the message, after the "error:" or "warning:" tag.
+	string_view body;
+	bool isNote = false;
+};
+
+
+
+#endif
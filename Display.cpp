@@ -4,20 +4,188 @@ Michael Zahniser, 19 Dec 2018
 
 #include "Display.h"
 
+#include "Diagnostic.h"
+#include "JsonWriter.h"
+#include "Record.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 
+#include <cerrno>
+
+#include <fcntl.h>
 #include <locale.h>
 #include <ncursesw/curses.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
 
 using namespace std;
 
+namespace {
+	// The maximum time to spend parsing output before redrawing the screen,
+	// and how many lines to parse between checks of the clock.
+	const chrono::milliseconds PARSE_BUDGET(10);
+	const int PARSE_CHECK_INTERVAL = 256;
+	// How long to wait after a source file changes before rebuilding, in case
+	// more files are about to change.
+	const chrono::milliseconds WATCH_DELAY(200);
+	// The file in the build directory where the messages from the last build
+	// are saved.
+	const string CACHE_PATH = ".gorp-cache";
+	// The tag to show in the header of a message with each status.
+	const string_view STATUS_TAGS[] = {"", "[new] ", "[persisting] ", "[fixed] "};
+	// What to call each type of message in the header of a group of messages.
+	const string_view GROUP_TYPE_NAMES[] = {" warnings", " errors", " link errors"};
+	// How many lines of the screen the source preview takes up, at most.
+	const int PREVIEW_HEIGHT = 10;
+	// How often to update the statistics, while they are being shown.
+	const chrono::milliseconds STATS_INTERVAL(1000);
+	
+	// Pipe that signal handlers write to, so that a signal wakes up poll().
+	int signalPipe[2] = {-1, -1};
+	
+	// Record that a signal was received, by writing its number to the pipe.
+	void OnSignal(int signal)
+	{
+		int error = errno;
+		char c = signal;
+		ssize_t written = write(signalPipe[1], &c, 1);
+		(void)written;
+		errno = error;
+	}
+	
+	// Expand the tabs in a line of source code into spaces, with tab stops every
+	// eight characters.
+	string ExpandTabs(string_view text)
+	{
+		string result;
+		int width = 0;
+		for(char c : text)
+		{
+			if(c == '\t')
+			{
+				result.append(8 - width % 8, ' ');
+				width += 8 - width % 8;
+				continue;
+			}
+			result += c;
+			width += ((c & 0b11000000) != 0b10000000);
+		}
+		return result;
+	}
+	
+	// Format a number with the given number of digits after the decimal point.
+	string Format(double value, int precision)
+	{
+		char buffer[32];
+		snprintf(buffer, sizeof(buffer), "%.*f", precision, value);
+		return buffer;
+	}
+	
+	// Format a number of bytes in the largest unit that it is at least one of.
+	string FormatBytes(uint64_t bytes)
+	{
+		static const char UNITS[] = "BKMGT";
+		double value = bytes;
+		int unit = 0;
+		for( ; value >= 1024. && unit < 4; ++unit)
+			value /= 1024.;
+		return Format(value, unit ? 1 : 0) + UNITS[unit];
+	}
+	
+	// Truncate or pad the given text to fill the given number of columns. The
+	// text may contain UTF-8.
+	string Fit(string_view text, int width)
+	{
+		int length = 0;
+		size_t pos = 0;
+		for( ; pos < text.length(); ++pos)
+		{
+			bool isStart = ((text[pos] & 0b11000000) != 0b10000000);
+			if(isStart && length == width)
+				break;
+			length += isStart;
+		}
+		string result(text.substr(0, pos));
+		result.append(width - length, ' ');
+		return result;
+	}
+	
+	// Get the name of a type of message, for machine-readable output.
+	const char *TypeName(Message::Type type)
+	{
+		if(type == Message::ERROR)
+			return "error";
+		if(type == Message::WARNING)
+			return "warning";
+		return (type == Message::LINK ? "link error" : "text");
+	}
+	
+	// Add the type of a message and the position it refers to, which are given
+	// on the first line of each message, to a JSON object.
+	void AddPosition(JsonWriter &json, Message::Type type, string_view header, string_view file, int line, int column)
+	{
+		json.Add("type", TypeName(type));
+		if(!header.empty())
+			json.Add("header", header);
+		if(!file.empty())
+			json.Add("file", file);
+		if(line >= 0)
+			json.Add("line", line);
+		if(column >= 0)
+			json.Add("column", column);
+	}
+	
+	// Describe a line of a message as a JSON object. Each line gets its own
+	// object, with the index of the message, so that lines can be sent without
+	// waiting for the message to end. Lines of notes and backtraces also say
+	// how deep they are in the message's tree of lines.
+	const string &RecordLine(JsonWriter &json, const Record &record, int index)
+	{
+		json.Clear();
+		json.Add("index", index);
+		if(record.action == Record::MESSAGE)
+		{
+			string_view file = string_view(record.text).substr(0, record.fileLength);
+			AddPosition(json, record.type, record.header, file, record.line, record.column);
+		}
+		else
+			json.Add("type", "text");
+		if(record.depth)
+			json.Add("depth", record.depth);
+		json.Add("text", record.text);
+		return json.Line();
+	}
+}
+
+
+
+// Replay the given build log instead of running the build or clean command.
+void Display::SetReplay(const string &log, const string &timing)
+{
+	replayLog = log;
+	replayTiming = timing;
+}
+
+
+
+// Rebuild automatically whenever a source file changes.
+void Display::SetWatch()
+{
+	watch = true;
+}
+
 
 
 // Initialize the display (and begin the build).
-void Display::Init(bool displayCommands)
+void Display::Init(bool displayCommands, bool isBatch)
 {
 	// Check for a .gorp file specifying the commands to use.
 	LoadCommands(getenv("HOME") + string("/.gorp"));
@@ -31,6 +199,26 @@ void Display::Init(bool displayCommands)
 		return;
 	}
 	
+	// Pass the diagnostics format to the compiler through the environment, so
+	// it works for any makefile that adds to CFLAGS or CXXFLAGS.
+	if(!diagnosticsFlag.empty())
+		for(const char *name : {"CFLAGS", "CXXFLAGS"})
+		{
+			const char *value = getenv(name);
+			setenv(name, ((value ? value + string(" ") : string()) + diagnosticsFlag).c_str(), true);
+		}
+	
+	if(isBatch)
+		return;
+	editor.SetCommand(editCommand, Server::SocketPath("-editor"));
+	
+	// Watch the whole tree that the build is run in.
+	if(watch)
+		watcher.WatchTree(".");
+	// If another copy of gorp is already running in this directory, it keeps
+	// the control socket.
+	server.Listen(Server::SocketPath());
+	
 	// Determine what the build and clean commands should be.
 	Launch(buildCommand);
 	
@@ -38,6 +226,9 @@ void Display::Init(bool displayCommands)
 	setlocale(LC_CTYPE,"");
 	initscr();
 	cbreak();
+	// Escape clears the filter, so it should not wait long to tell whether the
+	// escape starts a longer key sequence.
+	set_escdelay(25);
 	noecho();
 	nodelay(stdscr, true);
 	keypad(stdscr, true);
@@ -51,19 +242,88 @@ void Display::Init(bool displayCommands)
 	init_pair(COLOR_RED, COLOR_RED, -1);
 	init_pair(COLOR_YELLOW, COLOR_YELLOW, -1);
 	init_pair(COLOR_CYAN, COLOR_CYAN, -1);
+	
+	// Have SIGWINCH and SIGCHLD wake up the event loop. This replaces the
+	// SIGWINCH handler that ncurses installs, so resizing is done in Resize().
+	if(!pipe(signalPipe))
+	{
+		for(int fd : signalPipe)
+			fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		for(int fd : signalPipe)
+			fcntl(fd, F_SETFD, FD_CLOEXEC);
+		struct sigaction action = {};
+		action.sa_handler = OnSignal;
+		action.sa_flags = SA_RESTART;
+		sigemptyset(&action.sa_mask);
+		sigaction(SIGWINCH, &action, nullptr);
+		sigaction(SIGCHLD, &action, nullptr);
+	}
 }
 
 
 
-// Redraw the screen, then wait for the next event or input from the build
-// process and handle it appropriately. Return false if it's time to quit.
+// Handle any pending input and build output, redraw the screen, then wait
+// until there is more input, more output from the build process, or a
+// signal. Return false if it's time to quit.
 bool Display::Update()
 {
-	// If a quit event is received, tell the program to quit.
+	// Keyboard input is handled first, so that it is never stuck behind a
+	// backlog of build output. If a quit event is received, tell the program to
+	// quit.
 	if(!HandleEvents())
 		return false;
+	HandleRequests();
+	
+	ReadOutput();
+	// Redraw once a source file that the preview is waiting for is loaded.
+	if(sources.Receive() && showPreview)
+		isDirty = true;
+	
+	// Make sure any previous build that was cancelled is exiting. It may need
+	// to be checked on again later.
+	int timeout = worker.Reap();
+	// Likewise, clean up after any editors that have exited.
+	editor.Reap();
+	
+	// If a source file has changed, restart the build once things settle down.
+	if(hasChanged)
+	{
+		chrono::steady_clock::duration remaining = rebuildTime - chrono::steady_clock::now();
+		if(remaining.count() <= 0)
+		{
+			hasChanged = false;
+			isCleaning = false;
+			Launch(buildCommand);
+		}
+		else
+		{
+			int delay = chrono::ceil<chrono::milliseconds>(remaining).count();
+			timeout = (timeout < 0 ? delay : min(timeout, delay));
+		}
+	}
 	
-	ParseOutput();
+	// While the statistics are shown, they are updated once per second.
+	if(showStats)
+	{
+		int delay = UpdateStats();
+		timeout = (timeout < 0 ? delay : min(timeout, delay));
+	}
+	
+	// Only redraw if something has changed, and never more often than the
+	// maximum frame rate. If it's too soon to draw, wait until it is time.
+	if(isDirty)
+	{
+		chrono::steady_clock::duration remaining = lastFrame + frameInterval - chrono::steady_clock::now();
+		if(remaining.count() <= 0)
+			Draw();
+		else
+		{
+			++framesSkipped;
+			int delay = chrono::ceil<chrono::milliseconds>(remaining).count();
+			timeout = (timeout < 0 ? delay : min(timeout, delay));
+		}
+	}
+	Wait(timeout);
 	
 	return true;
 }
@@ -79,6 +339,93 @@ void Display::Cleanup()
 
 
 
+// Run the build without using the terminal, printing each message to STDOUT as
+// a line of JSON as soon as it has been parsed, followed by a summary.
+int Display::Batch()
+{
+	StartWorker(buildCommand);
+	bool isDone = false;
+	int exitStatus = 0;
+	while(!isDone)
+	{
+		RecordBatch *batch = worker.Receive();
+		if(!batch)
+		{
+			pollfd fd = {worker.ReadyPipe(), POLLIN, 0};
+			poll(&fd, 1, -1);
+			continue;
+		}
+		
+		for(size_t i = 0; i < batch->Size(); ++i)
+		{
+			const Record &record = (*batch)[i];
+			if(record.action == Record::DONE)
+			{
+				buildTime += chrono::steady_clock::now() - buildStart;
+				isBuilding = false;
+				isDone = true;
+				exitStatus = record.exitStatus;
+			}
+			if(record.action == Record::NONE || record.action == Record::DONE)
+				continue;
+			
+			if(record.action == Record::MESSAGE)
+			{
+				// Every message is printed, but repeats are not counted as unique.
+				Diagnostic diagnostic;
+				record.GetDiagnostic(diagnostic);
+				++messageCount[record.type];
+				if(keyIndex.emplace(messages.Key(diagnostic), record.index).second)
+					++uniqueCount[record.type];
+			}
+			const string &line = RecordLine(json, record, record.index);
+			fwrite(line.data(), 1, line.size(), stdout);
+		}
+		worker.Release(batch);
+		fflush(stdout);
+	}
+	
+	json.Clear();
+	json.Add("type", "summary");
+	AddCounts();
+	json.Add("status", exitStatus);
+	fputs(json.Line().c_str(), stdout);
+	fflush(stdout);
+	
+	// A build can fail without printing any errors that can be parsed, e.g. if
+	// the compiler crashes or the build command is not found.
+	return (messageCount[Message::ERROR] || messageCount[Message::LINK] || exitStatus);
+}
+
+
+
+// Print statistics about how much work gorp did and how much memory it is using.
+void Display::PrintStats(ostream &out) const
+{
+	const Worker::Stats &stats = worker.GetStats();
+	uint64_t lines = stats.lines;
+	chrono::steady_clock::duration elapsed = buildTime;
+	if(isBuilding)
+		elapsed += chrono::steady_clock::now() - buildStart;
+	double seconds = chrono::duration<double>(elapsed).count();
+	double average = (framesDrawn ? chrono::duration<double, milli>(frameTime).count() / framesDrawn : 0.);
+	
+	out << "Lines read:        " << lines << " (" << FormatBytes(stats.bytes) << ")" << endl;
+	out << "Lines per second:  " << static_cast<uint64_t>(seconds > 0. ? lines / seconds : 0.)
+		<< " (over " << Format(seconds, 1) << " s of building)" << endl;
+	out << "Parse time:        " << Format(lines ? stats.parseTime / 1000. / lines : 0., 3) << " us per line" << endl;
+	out << "Buffered output:   " << FormatBytes(stats.buffered) << " (" << FormatBytes(stats.bufferCapacity) << " allocated)" << endl;
+	out << "Frames drawn:      " << framesDrawn << " (" << Format(average, 2) << " ms average, "
+		<< Format(chrono::duration<double, milli>(maxFrameTime).count(), 2) << " ms max)" << endl;
+	out << "Redraws skipped:   " << framesSkipped << endl;
+	out << "Message memory:    " << FormatBytes(messages.Capacity()) << " (" << messages.Size() << " messages)" << endl;
+	out << "Search index:      " << FormatBytes(searchIndex.Capacity()) << endl;
+	out << "Source cache:      " << FormatBytes(sources.Capacity()) << " (" << sources.Size() << " files)" << endl;
+	out << "Output memory:     " << FormatBytes(output.Capacity()) << " (" << FormatBytes(output.FileSize()) << " in the log file)" << endl;
+}
+
+
+
 // Check for a .gorp file specifying the commands to use.
 void Display::LoadCommands(const string &path)
 {
@@ -103,6 +450,25 @@ void Display::LoadCommands(const string &path)
 			cleanCommand = command;
 		else if(tag == "edit:")
 			editCommand = command;
+		else if(tag == "fps:")
+		{
+			// A frame rate of zero means there is no limit.
+			int frameRate = atoi(command.data());
+			frameInterval = chrono::microseconds(frameRate > 0 ? 1000000 / frameRate : 0);
+		}
+		else if(tag == "watch:")
+			watch = (command == "on" || command == "yes" || command == "true" || command == "1");
+		else if(tag == "diagnostics:")
+		{
+			// Ask the compiler for machine-readable diagnostics. Clang only
+			// supports SARIF, and GCC supports both.
+			if(command == "json")
+				diagnosticsFlag = "-fdiagnostics-format=json";
+			else if(command == "sarif")
+				diagnosticsFlag = "-fdiagnostics-format=sarif-stderr";
+			else
+				diagnosticsFlag.clear();
+		}
 	}
 }
 
@@ -111,98 +477,397 @@ void Display::LoadCommands(const string &path)
 // Launch the given command, after cleaning up previous data.
 void Display::Launch(const string &command)
 {
-	// Clean up.
-	messages.clear();
+	// Clean up. The build may be starting because source files have changed,
+	// so any that are loaded may be out of date.
+	ClearMessages();
+	sources.Clear();
 	messageCount.clear();
-	output.clear();
-	errorLocation.clear();
-	previousError.clear();
-	errorLinesAfter = 0;
+	uniqueCount.clear();
+	fixedCount = 0;
+	output.Clear();
+	outputScroll = -1;
+	
+	// A build is compared to the last build that finished, which is loaded
+	// from the cache (unless a saved log is being replayed instead). Its
+	// messages are also shown until the build produces any of its own, so
+	// they are copied rather than reading the cache a second time.
+	hasPrevious = false;
+	unseen.clear();
+	if(!isCleaning && replayLog.empty() && previous.Load(CACHE_PATH))
+	{
+		hasPrevious = true;
+		for(int i = 0; i < previous.Size(); ++i)
+		{
+			++unseen[previous[i].Key()];
+			AddToView(messages.Copy(previous, i));
+		}
+		isStale = !messages.IsEmpty();
+	}
+	
+	// Launch the new command.
+	title = (replayLog.empty() ? command : "Replaying " + replayLog);
+	batch = nullptr;
+	StartWorker(command);
+	isDirty = true;
+	if(server.HasSubscribers())
+		server.Broadcast(StatusLine());
+}
+
+
+
+// Remove all the messages.
+void Display::ClearMessages()
+{
+	messages.Clear();
+	lineCounts.Clear();
+	searchIndex.Clear();
+	isHidden.clear();
+	shownCount = 0;
+	groups.Clear();
+	isViewChanged = false;
+	prefetchedPaths = 0;
+	keyIndex.clear();
+	listIndex.clear();
+	watchedPaths = 0;
 	selectedIndex = -1;
 	scrollIndex = 0;
+	isStale = false;
+	isDirty = true;
+}
+
+
+
+// Start the worker running the given command, or replaying the log if there is
+// one.
+void Display::StartWorker(const string &command)
+{
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	if(isBuilding)
+		buildTime += now - buildStart;
+	buildStart = now;
+	isBuilding = true;
+	isCancelled = false;
 	
-	// Launch the new command.
-	title = command;
-	process.Start(command);
+	if(replayLog.empty())
+		worker.Start(command);
+	else
+		worker.Replay(replayLog, replayTiming);
+}
+
+
+
+// Stop the current command, keeping whatever output has been handled.
+void Display::Cancel()
+{
+	if(!isBuilding)
+		return;
 	
-	// Until the command is done running, ncurses should run in polling mode
-	// instead of blocking mode.
-	nodelay(stdscr, true);
+	// Any output the worker has parsed but this thread has not handled yet is
+	// thrown away along with the batch it is in.
+	worker.Stop();
+	batch = nullptr;
+	buildTime += chrono::steady_clock::now() - buildStart;
+	isBuilding = false;
+	isCancelled = true;
+	title = (isCleaning ? "Cleaning cancelled." : "Build cancelled.");
+	isDirty = true;
+	if(server.HasSubscribers())
+		server.Broadcast(StatusLine());
 }
 
 
 
+// Block until keyboard or mouse input, build output, a request on the control
+// socket, or a signal arrives, or until the given number of milliseconds have
+// passed (if it is not negative).
+void Display::Wait(int timeout)
+{
+	// If there is output that has not been handled yet, don't block.
+	if(batch)
+		timeout = 0;
+	
+	fds.assign({
+		{STDIN_FILENO, POLLIN, 0},
+		{signalPipe[0], POLLIN, 0},
+		{worker.ReadyPipe(), POLLIN, 0},
+		{watcher.EventFd(), POLLIN, 0},
+		{sources.ReadyPipe(), POLLIN, 0}
+	});
+	server.Prepare(fds);
+	if(poll(fds.data(), fds.size(), timeout) < 0)
+		return;
+	server.Handle(fds.data() + 5);
+	
+	// Each change to a source file pushes back the time to rebuild.
+	if(fds[3].revents && watcher.Read())
+	{
+		hasChanged = true;
+		rebuildTime = chrono::steady_clock::now() + WATCH_DELAY;
+	}
+	
+	// Check what signals have been received.
+	char signals[64];
+	int count = (fds[1].revents ? read(signalPipe[0], signals, sizeof(signals)) : 0);
+	for(int i = 0; i < count; ++i)
+		if(signals[i] == SIGWINCH)
+			Resize();
+}
+
+
+
+// Handle a change in the size of the terminal.
+void Display::Resize()
+{
+	winsize size;
+	if(!ioctl(STDOUT_FILENO, TIOCGWINSZ, &size))
+		resizeterm(size.ws_row, size.ws_col);
+	isDirty = true;
+}
+
+
+
+// Redraw the screen. Only rows whose contents have changed since the last
+// time they were drawn are actually sent to ncurses.
 void Display::Draw()
 {
-	// Get the size of the terminal.
+	// Get the size of the terminal. If it has changed, nothing that was drawn
+	// before can be assumed to still be on screen.
+	int oldLines = lines;
+	int oldColumns = columns;
 	getmaxyx(stdscr, lines, columns);
+	if(lines != oldLines || columns != oldColumns)
+		rows.assign(lines, Row());
 	
-	// Display the current output line.
-	attron(A_REVERSE);
-	DrawText(title, 0);
-	attroff(A_REVERSE);
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	UpdateView();
 	
-	if(messages.empty())
-		DrawOutput();
+	// Display the current output line, with the filter and the statistics at
+	// the right end of it if they are being shown.
+	string status = FilterText();
+	if(showStats)
+		status += StatsText();
+	if(!status.empty())
+	{
+		int width = max(0, columns - static_cast<int>(status.size()));
+		DrawText(Fit(title, width) + status, 0, A_REVERSE);
+	}
 	else
-		DrawErrors();
+		DrawText(title, 0, A_REVERSE);
 	
-	// Clear to the end of the screen, then refresh the screen.
-	clrtobot();
+	int line = (messages.IsEmpty() ? DrawOutput() : DrawErrors());
+	
+	// Clear to the end of the screen, then refresh the screen. If the preview
+	// is shown, it fills the bottom of the screen, below the messages.
+	for(int end = ListEnd(); line < end; ++line)
+		DrawText("", line, A_NORMAL);
+	if(line < lines)
+		line = DrawPreview(line);
+	for( ; line < lines; ++line)
+		DrawText("", line, A_NORMAL);
 	refresh();
+	
+	isDirty = false;
+	lastFrame = chrono::steady_clock::now();
+	++framesDrawn;
+	frameTime += lastFrame - start;
+	maxFrameTime = max(maxFrameTime, lastFrame - start);
+}
+
+
+
+// Get the statistics to show in the title row.
+string Display::StatsText() const
+{
+	const Worker::Stats &stats = worker.GetStats();
+	uint64_t lines = stats.lines;
+	double parseTime = (lines ? stats.parseTime / 1000. / lines : 0.);
+	double frame = (framesDrawn ? chrono::duration<double, milli>(frameTime).count() / framesDrawn : 0.);
+	return " " + Format(lineRate, 0) + " lines/s | " + Format(parseTime, 2) + " us/line | buf "
+		+ FormatBytes(stats.buffered) + "/" + FormatBytes(stats.bufferCapacity) + " | frame "
+		+ Format(frame, 2) + " ms | skip " + to_string(framesSkipped) + " | msgs "
+		+ FormatBytes(messages.Capacity()) + " | out " + FormatBytes(output.Capacity()) + " ";
+}
+
+
+
+// Get the filter to show in the title row, if there is one. While it is being
+// typed, it is shown even if it is empty.
+string Display::FilterText() const
+{
+	if(filter.IsEmpty() && !isEditingFilter)
+		return string();
+	
+	return " [/" + filterQuery + (isEditingFilter ? "_" : "") + ": " + to_string(shownCount)
+		+ " of " + to_string(messages.Size()) + "] ";
+}
+
+
+
+// If it is time to, sample how fast the build output is being read, and return
+// the time until the next sample (in milliseconds).
+int Display::UpdateStats()
+{
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	chrono::steady_clock::duration elapsed = now - sampleTime;
+	if(elapsed >= STATS_INTERVAL)
+	{
+		uint64_t lines = worker.GetStats().lines;
+		lineRate = (lines - sampleLines) / chrono::duration<double>(elapsed).count();
+		sampleLines = lines;
+		sampleTime = now;
+		elapsed = chrono::steady_clock::duration::zero();
+		isDirty = true;
+	}
+	return chrono::ceil<chrono::milliseconds>(STATS_INTERVAL - elapsed).count();
 }
 
 
 
-void Display::DrawOutput()
+// Draw the most recent output, and return the index of the first line on the
+// screen that was not drawn.
+int Display::DrawOutput()
 {
-	// Scroll so that the most recent line of output is always visible.
-	vector<string>::const_iterator it = output.begin() + max<int>(0, output.size() - (lines - 1));
+	// Unless the user has scrolled back, scroll so that the most recent line of
+	// output is always visible.
+	size_t size = output.Size();
+	size_t index = (outputScroll < 0 ? size - min<size_t>(size, lines - 1) : outputScroll);
 	
-	for(int line = 1; line < lines && it != output.end(); ++it, ++line)
-		DrawText(*it, line);
+	int line = 1;
+	for( ; line < lines && index < size; ++index, ++line)
+		DrawText(output.Line(index), line, A_NORMAL);
+	return line;
 }
 
 
 
-void Display::DrawErrors()
+// Draw the visible messages, and return the index of the first line on the
+// screen that was not drawn.
+int Display::DrawErrors()
 {
-	// Display any messages received so far.
-	int line = 0;
-	for(int index = scrollIndex; index < static_cast<int>(messages.size()) && line < lines; ++index)
+	// Display any messages received so far, above the preview if it is shown.
+	int line = 1;
+	int end = ListEnd();
+	if(!shownCount)
+		DrawText("No messages match the filter.", line++, A_NORMAL);
+	
+	// Messages that the filter hides take up no lines, so finding the message
+	// that comes after each one's lines skips over them.
+	string tagged;
+	for(int index = lineCounts.Find(lineCounts.Sum(scrollIndex)); index < lineCounts.Size() && line < end;
+			index = lineCounts.Find(lineCounts.Sum(index + 1)))
 	{
-		const Message &message = messages[index];
 		bool isSelected = (index == selectedIndex);
-		int color = COLOR_PAIR(message.Color());
-		attron(color);
-		bool first = true;
-		for(const string &text : message.Text())
+		int item = Item(index);
+		if(item < 0)
+		{
+			DrawText(GroupHeader(-1 - item), line++, isSelected ? A_REVERSE : A_BOLD);
+			continue;
+		}
+		const Message &message = messages[item];
+		// Only the first line should be drawn in color. Subsequent lines should
+		// be highlighted if this message is selected. Fixed messages are dimmed.
+		int attributes = COLOR_PAIR(message.Color()) | (message.GetStatus() == Message::FIXED ? A_DIM : 0);
+		string_view tag = STATUS_TAGS[message.GetStatus()];
+		MessageList::Lines range = messages.Text(item);
+		for(MessageList::Lines::Iterator it = range.begin(); it != range.end(); ++it)
 		{
-			// Stop drawing if we've reached the bottom of the screen.
-			if(++line >= lines)
+			// Stop drawing if we've reached the bottom of the screen. Unless this
+			// message is selected, only its lines at depth 0 are drawn, and those
+			// always come first.
+			int depth = it.Depth();
+			if(line >= end || (depth && !isSelected))
 				break;
-			DrawText(text, line);
-			
-			if(first)
+			string_view text = *it;
+			// The header says how the message compares to the previous build,
+			// right after the block that comes before the header itself.
+			if(!tag.empty())
+			{
+				string_view header = messages.Header(item);
+				tagged.assign(text.substr(0, text.size() - header.size()));
+				tagged.append(tag);
+				tagged.append(header);
+				text = tagged;
+				tag = string_view();
+			}
+			// Notes and backtraces are indented to show which line they explain.
+			else if(depth)
 			{
-				first = false;
-				// Only the first line should be drawn in color.
-				attroff(color);
-				// Subsequent lines should be highlighted if this line is selected.
-				if(isSelected)
-					attron(A_REVERSE);
+				tagged.assign(2 * depth, ' ');
+				tagged.append(text);
+				text = tagged;
 			}
+			DrawText(text, line++, attributes);
+			attributes = (isSelected ? A_REVERSE : A_NORMAL);
+		}
+		if(!isSelected && message.HiddenLineCount() && line < end)
+			DrawText("    ▸ " + to_string(message.HiddenLineCount()) + " more lines", line++, attributes);
+		// A repeated message says so on a line of its own, naming as many of the
+		// files it came from as fit on the screen.
+		if(message.Occurrences() > 1 && line < end)
+		{
+			int units = messages.UnitCount(item);
+			tagged = "    Repeated " + to_string(message.Occurrences()) + " times";
+			if(units > 1)
+				tagged += ", in " + to_string(units) + " files:";
+			for(int i = 0; units > 1 && i < units && tagged.size() < static_cast<size_t>(columns); ++i)
+			{
+				tagged += (i ? ", " : " ");
+				tagged += messages.Unit(item, i);
+			}
+			DrawText(tagged, line++, attributes);
 		}
-		if(first)
-			attroff(color);
-		if(isSelected)
-			attroff(A_REVERSE);
 	}
+	return line;
 }
 
 
 
-void Display::DrawText(string text, int line)
+// Draw the source code around the selected message, starting on the given line,
+// and return the index of the first line below what it drew.
+int Display::DrawPreview(int line)
+{
+	int item = (selectedIndex >= 0 ? Item(selectedIndex) : -1);
+	if(item < 0 || messages[item].File() < 0)
+	{
+		DrawText("Select a message to preview its source.", line++, A_REVERSE);
+		return line;
+	}
+	const Message &message = messages[item];
+	string path(messages.Path(message.File()));
+	DrawText(path + ":" + to_string(message.Line()), line++, A_REVERSE);
+	
+	// The file is loaded in the background, and the screen is redrawn once it
+	// has been.
+	const SourceCache::File *file = sources.Get(path);
+	if(!file || !file->IsValid())
+	{
+		DrawText(file ? "This file cannot be read." : "Loading...", line++, A_DIM);
+		return line;
+	}
+	
+	// Show the message's line in the middle, with a caret under its column. GCC
+	// counts columns as they are displayed, with tabs expanded, just as they
+	// are here.
+	int first = max(1, message.Line() - (lines - line - 2) / 2);
+	char number[16];
+	for(int i = first; i <= file->LineCount() && line < lines; ++i)
+	{
+		snprintf(number, sizeof(number), "%5d | ", i);
+		string_view text = file->Line(i);
+		bool isTarget = (i == message.Line());
+		DrawText(number + ExpandTabs(text), line++, isTarget ? A_BOLD : A_NORMAL);
+		if(isTarget && message.Column() > 0 && line < lines)
+			DrawText("      | " + string(message.Column() - 1, ' ') + "^", line++, COLOR_PAIR(message.Color()) | A_BOLD);
+	}
+	return line;
+}
+
+
+
+// Draw the given text on the given line, truncating or padding it to exactly
+// fill the width of the screen. If that line already shows exactly this text,
+// it is left alone.
+void Display::DrawText(string_view text, int line, int attributes)
 {
 	// First, find the length of the string, which may contain UTF-8.
 	int length = 0;
@@ -212,14 +877,44 @@ void Display::DrawText(string text, int line)
 	
 	// If the string is longer than the number of columns, truncate it. If it is
 	// shorter, pad it with spaces.
+	string padded(text.substr(0, pos));
 	if(length < columns)
-		text.append(columns - length, ' ');
-	else if(pos < text.length())
-		text.erase(pos);
+		padded.append(columns - length, ' ');
+	
+	// Skip this line if it has not changed since it was last drawn.
+	Row &row = rows[line];
+	if(row.attributes == attributes && row.text == padded)
+		return;
+	row.attributes = attributes;
+	row.text.swap(padded);
 	
 	// Now, display the string.
+	attrset(attributes);
 	move(line, 0);
-	addstr(text.data());
+	addstr(row.text.data());
+	attrset(A_NORMAL);
+}
+
+
+
+// Get the header row for the given group of messages: the path of its file, and
+// how many of each type of message it has.
+string Display::GroupHeader(int group) const
+{
+	int file = groups.File(group);
+	string text = (groups.IsCollapsed(group) ? "▸ " : "▾ ");
+	text += (file >= 0 ? messages.Path(file) : string_view("(no file)"));
+	
+	string counts;
+	for(Message::Type type : {Message::ERROR, Message::WARNING, Message::LINK})
+		if(groups.Count(group, type))
+		{
+			counts += (counts.empty() ? " (" : ", ") + to_string(groups.Count(group, type));
+			counts += GROUP_TYPE_NAMES[type];
+		}
+	if(!counts.empty())
+		text += counts + ")";
+	return text;
 }
 
 
@@ -228,27 +923,39 @@ bool Display::HandleEvents()
 {
 	while(true)
 	{
-		Draw();
-		
-		// If the command is still running, parse its output.
+		// Input is read in polling mode; Wait() blocks until more is available.
 		int input = getch();
 		if(input == ERR)
 			return true;
+		isDirty = true;
+		UpdateView();
+		
+		// While the filter is being typed, most keys are part of it.
+		if(isEditingFilter && EditFilter(input))
+			continue;
+		// Until there are messages, the arrow and page keys scroll the output.
+		if(messages.IsEmpty() && ScrollOutput(input))
+			continue;
 		
 		// This is set if a message should be "opened" either because the return
 		// key was pressed or a message was clicked.
 		int openIndex = -1;
 		
 		// Switch based on the input.
+		// The arrow keys move to the next or previous message that the filter
+		// shows. Hidden messages take up no lines, so they are never found.
 		if(input == KEY_DOWN)
 		{
-			selectedIndex = min<int>(messages.size() - 1, selectedIndex + 1);
+			int next = lineCounts.Find(lineCounts.Sum(selectedIndex + 1));
+			if(next < lineCounts.Size())
+				Select(next);
 			while(selectedIndex > LastVisibleIndex())
 				ScrollDown();
 		}
 		else if(input == KEY_UP)
 		{
-			selectedIndex = max(-1, selectedIndex - 1);
+			int before = lineCounts.Sum(max(0, selectedIndex));
+			Select(before ? lineCounts.Find(before - 1) : -1);
 			while(selectedIndex >= 0 && selectedIndex < scrollIndex)
 				ScrollUp();
 		}
@@ -256,27 +963,59 @@ bool Display::HandleEvents()
 		{
 			int offset = selectedIndex - scrollIndex;
 			ScrollUp();
-			selectedIndex = scrollIndex + offset;
+			if(selectedIndex >= 0)
+				Select(NearestShown(scrollIndex + offset));
 		}
 		else if(input == KEY_NPAGE)
 		{
 			int offset = selectedIndex - scrollIndex;
 			ScrollDown();
-			selectedIndex = scrollIndex + offset;
+			if(selectedIndex >= 0)
+				Select(NearestShown(scrollIndex + offset));
 		}
 		else if(input == 'q')
 			return false;
+		else if(input == '/')
+		{
+			isEditingFilter = true;
+			ApplyFilter();
+		}
+		else if(input == 27 && !filterQuery.empty())
+		{
+			filterQuery.clear();
+			ApplyFilter();
+		}
+		else if(input == 'g')
+			ToggleGroups();
+		else if(input == 'p')
+		{
+			// The list of messages gets shorter when the preview is shown, so
+			// the selected message may need to be scrolled to.
+			showPreview = !showPreview;
+			if(selectedIndex >= 0 && selectedIndex > LastVisibleIndex())
+				scrollIndex = PageBefore(selectedIndex + 1);
+			if(showPreview)
+				PrefetchAround(selectedIndex);
+		}
+		else if(input == 's')
+		{
+			// Start measuring the line rate from now.
+			showStats = !showStats;
+			sampleTime = chrono::steady_clock::now();
+			sampleLines = worker.GetStats().lines;
+			lineRate = 0.;
+		}
 		else if(input == '\n')
 			openIndex = selectedIndex;
 		else if(input == ' ')
 		{
-			Launch(buildCommand);
 			isCleaning = false;
+			Launch(buildCommand);
 		}
 		else if(input == KEY_BACKSPACE || input == KEY_DL)
 		{
-			Launch(cleanCommand);
 			isCleaning = true;
+			Launch(cleanCommand);
 		}
 		else if(input == KEY_MOUSE)
 		{
@@ -285,47 +1024,247 @@ bool Display::HandleEvents()
 			{
 				if(event.bstate & BUTTON1_PRESSED)
 				{
-					int index = LineIndex(event.y);
-					if(index != static_cast<int>(messages.size()))
-						openIndex = selectedIndex = index;
+					int index = (event.y < ListEnd() ? LineIndex(event.y) : lineCounts.Size());
+					if(index != lineCounts.Size())
+					{
+						Select(index);
+						openIndex = index;
+					}
 				}
 				// Scroll wheel handling requires ncurses6.
 				else if(event.bstate & BUTTON4_CLICKED)
 					scrollIndex = max(0, scrollIndex - 1);
 				else if(event.bstate & BUTTON5_CLICKED)
-					scrollIndex = min(static_cast<int>(messages.size()) - 1, scrollIndex + 1);
+					scrollIndex = min(lineCounts.Size() - 1, scrollIndex + 1);
 			}
 		}
 		
-		// If we're supposed to open a file, send the command to open it.
-		if(openIndex >= 0 && !messages[openIndex].File().empty())
+		// If we're supposed to open a file, have the editor open it. Opening the
+		// header of a group of messages collapses or expands it instead.
+		int item = (openIndex >= 0 ? Item(openIndex) : 0);
+		if(openIndex >= 0 && item < 0)
+			ToggleGroup(-1 - item);
+		else if(openIndex >= 0 && messages[item].File() >= 0)
 		{
-			const Message &message = messages[openIndex];
-			
-			map<string, string> sub;
-			sub["FILE"] = message.File();
-			sub["LINE"] = (message.Line() > 0) ? to_string(message.Line()) : "1";
-			sub["COLUMN"] = (message.Column() > 0) ? to_string(message.Column()) : "1";
-			
-			// Always launch the command in an independent shell.
-			string command = "(" + editCommand + " &)";
-			for(const pair<string, string> &it : sub)
-			{
-				size_t pos = command.find(it.first);
-				if(pos != string::npos)
-					command.replace(pos, it.first.length(), it.second);
-			}
-			system(command.data());
+			const Message &message = messages[item];
+			editor.Open(string(messages.Path(message.File())), message.Line(), message.Column());
 		}
 	}
 }
 
 
 
+// Scroll the build output in response to the given key. Return false if that
+// key does not scroll.
+bool Display::ScrollOutput(int input)
+{
+	long page = max(1, lines - 1);
+	long last = max<long>(0, output.Size() - page);
+	long first = (outputScroll < 0 ? last : outputScroll);
+	
+	if(input == KEY_UP)
+		--first;
+	else if(input == KEY_DOWN)
+		++first;
+	else if(input == KEY_PPAGE)
+		first -= page;
+	else if(input == KEY_NPAGE)
+		first += page;
+	else
+		return false;
+	
+	// Scrolling all the way to the end resumes following new output.
+	outputScroll = (first >= last ? -1 : max<long>(0, first));
+	return true;
+}
+
+
+
+// Handle a key pressed while the filter is being typed. Return false if the key
+// is not part of the filter, so it should be handled as usual.
+bool Display::EditFilter(int input)
+{
+	// Enter keeps the filter, and escape removes it.
+	if(input == '\n' || input == 27)
+	{
+		isEditingFilter = false;
+		if(input == 27)
+			filterQuery.clear();
+	}
+	else if(input == KEY_BACKSPACE || input == 127 || input == '\b')
+	{
+		// Erase a whole UTF-8 character. Erasing when there is nothing left to
+		// erase stops editing.
+		while(!filterQuery.empty() && (filterQuery.back() & 0b11000000) == 0b10000000)
+			filterQuery.pop_back();
+		if(filterQuery.empty())
+			isEditingFilter = false;
+		else
+			filterQuery.pop_back();
+	}
+	else if(input >= ' ' && input < 0x100)
+		filterQuery += static_cast<char>(input);
+	else
+		return false;
+	
+	ApplyFilter();
+	return true;
+}
+
+
+
+// Apply the filter to all the messages, after it has changed. Every message may
+// now take up a different number of lines.
+void Display::ApplyFilter()
+{
+	filter.Set(filterQuery);
+	shownCount = filter.Apply(messages, searchIndex, isHidden);
+	if(selectedIndex >= 0 && !LineCount(selectedIndex))
+		selectedIndex = -1;
+	CountLines();
+	
+	// Keep the selected message in view, if there is one.
+	scrollIndex = (selectedIndex >= 0 ? PageBefore(selectedIndex + 1) : 0);
+	isDirty = true;
+}
+
+
+
+// Switch between listing the messages in the order they arrived in and grouping
+// them by file. The groups are built from scratch each time, since they are not
+// kept up to date while the messages are not grouped.
+void Display::ToggleGroups()
+{
+	// Keep the same message selected. If a group's header is selected, select
+	// its first message instead.
+	int selected = -1;
+	if(selectedIndex >= 0)
+	{
+		int item = Item(selectedIndex);
+		selected = (item >= 0 ? item : groups.Messages(-1 - item).front());
+	}
+	
+	isGrouped = !isGrouped;
+	groups.Clear();
+	if(isGrouped)
+	{
+		for(int i = 0; i < messages.Size(); ++i)
+			groups.Add(messages, i);
+		groups.Build();
+	}
+	isViewChanged = false;
+	selectedIndex = (selected >= 0 ? Position(selected) : -1);
+	CountLines();
+	scrollIndex = (selectedIndex >= 0 ? PageBefore(selectedIndex + 1) : 0);
+}
+
+
+
+// Collapse or expand the given group of messages.
+void Display::ToggleGroup(int group)
+{
+	groups.SetCollapsed(group, !groups.IsCollapsed(group));
+	
+	// The group's messages come right after its header.
+	int first = Position(-1 - group) + 1;
+	int last = first + groups.Messages(group).size();
+	for(int index = first; index < last; ++index)
+		lineCounts.Set(index, LineCount(index));
+}
+
+
+
+// If messages have been added to the groups since the list was last built,
+// rebuild it. New messages may be anywhere in the list, so the items that were
+// selected and at the top of the screen are found again afterwards, unless the
+// list was scrolled all the way to the top, in which case it stays there.
+void Display::UpdateView()
+{
+	if(!isViewChanged)
+		return;
+	isViewChanged = false;
+	
+	bool hasSelection = (selectedIndex >= 0);
+	bool hasTop = (scrollIndex > 0 && scrollIndex < lineCounts.Size());
+	int selected = (hasSelection ? Item(selectedIndex) : 0);
+	int top = (hasTop ? Item(scrollIndex) : 0);
+	groups.Build();
+	if(hasSelection)
+		selectedIndex = Position(selected);
+	if(hasTop)
+		scrollIndex = Position(top);
+	CountLines();
+}
+
+
+
+// Recount how many lines of the screen every item in the list takes up.
+void Display::CountLines()
+{
+	lineCounts.Clear();
+	int size = (isGrouped ? groups.Size() : messages.Size());
+	for(int index = 0; index < size; ++index)
+		lineCounts.Add(LineCount(index));
+}
+
+
+
+// Get what is shown at the given index in the list.
+int Display::Item(int index) const
+{
+	return (isGrouped ? groups.Item(index) : index);
+}
+
+
+
+// Get the index in the list where the given item is shown.
+int Display::Position(int item) const
+{
+	return (isGrouped ? groups.Position(item) : item);
+}
+
+
+
+// Get the number of lines of the screen the preview takes up. It is only shown
+// along with the list of messages, not the build output.
+int Display::PreviewHeight() const
+{
+	return (showPreview && !messages.IsEmpty() ? min(PREVIEW_HEIGHT, lines / 2) : 0);
+}
+
+
+
+// Get the index of the first line below the list of messages.
+int Display::ListEnd() const
+{
+	return lines - PreviewHeight();
+}
+
+
+
+// Start loading the source files of the item with the given index in the list
+// and the ones next to it, which may be selected next.
+void Display::PrefetchAround(int index)
+{
+	int before = lineCounts.Sum(max(0, index));
+	int previous = (before ? lineCounts.Find(before - 1) : -1);
+	int next = lineCounts.Find(lineCounts.Sum(index + 1));
+	for(int it : {index, previous, next})
+		if(it >= 0 && it < lineCounts.Size())
+		{
+			int item = Item(it);
+			int file = (item >= 0 ? messages[item].File() : groups.File(-1 - item));
+			if(file >= 0)
+				sources.Get(string(messages.Path(file)));
+		}
+}
+
+
+
 // Get the index of the last visible message.
 int Display::LastVisibleIndex() const
 {
-	return LineIndex(lines - 1);
+	return LineIndex(ListEnd() - 1);
 }
 
 
@@ -334,31 +1273,22 @@ int Display::LastVisibleIndex() const
 // message would be fully on-screen.
 int Display::MaxScrollIndex() const
 {
-	return PageBefore(messages.size());
+	return PageBefore(lineCounts.Size());
 }
 
 
 
 // Get the index of the message displayed on the given line. If line 0 is given,
 // this returns -1. If a line after the last message is given, this returns the
-// size of the messages vector.
+// number of items in the list.
 int Display::LineIndex(int line) const
 {
-	// Special cases: line 0 has no message on it, and line 1 is the scroll index.
-	if(line <= 1)
-		return (line == 1 ? scrollIndex : -1);
+	// Special case: line 0 has no message on it. Line 1 is usually the scroll
+	// index, but not if the filter hides that message.
+	if(line <= 0)
+		return -1;
 	
-	int currentLine = 1;
-	int index = scrollIndex;
-	int size = messages.size();
-	while(index < size)
-	{
-		currentLine += messages[index].Text().size();
-		if(currentLine > line)
-			break;
-		++index;
-	}
-	return index;
+	return lineCounts.Find(lineCounts.Sum(scrollIndex) + line - 1);
 }
 
 
@@ -366,15 +1296,72 @@ int Display::LineIndex(int line) const
 // Get the index of the message that's a page before the given index.
 int Display::PageBefore(int index) const
 {
-	int line = lines - 1;
-	while(index > 0)
+	// Find the first message such that it and all the messages after it, up to
+	// the given index, fit on one page (leaving room for the title line).
+	int first = lineCounts.Sum(index) - (ListEnd() - 2);
+	if(first <= 0)
+		return 0;
+	return lineCounts.Find(first - 1) + 1;
+}
+
+
+
+// Get the index of the shown message nearest to the given index, looking after
+// it first. If the filter hides every message, return -1.
+int Display::NearestShown(int index) const
+{
+	int before = lineCounts.Sum(max(0, min(index, lineCounts.Size())));
+	int next = lineCounts.Find(before);
+	if(next < lineCounts.Size())
+		return next;
+	return (before ? lineCounts.Find(before - 1) : -1);
+}
+
+
+
+// Select the message with the given index, or none if the index is -1.
+void Display::Select(int index)
+{
+	// Only the selected message is expanded, so the one that was selected
+	// before now takes up fewer lines.
+	int previous = selectedIndex;
+	selectedIndex = index;
+	for(int it : {previous, index})
+		if(it >= 0 && it < lineCounts.Size())
+			lineCounts.Set(it, LineCount(it));
+	if(showPreview)
+		PrefetchAround(index);
+}
+
+
+
+// Get how many lines of the screen the item with the given index takes up.
+int Display::LineCount(int index) const
+{
+	// A group's header is only shown if any of its messages are.
+	int item = Item(index);
+	if(item < 0)
 	{
-		line -= messages[index - 1].Text().size();
-		if(line < 1)
-			break;
-		--index;
+		const vector<int> &list = groups.Messages(-1 - item);
+		return any_of(list.begin(), list.end(), [this](int message) { return !isHidden[message]; });
 	}
-	return index;
+	if(isHidden[item] || (isGrouped && groups.IsCollapsed(groups.Group(item))))
+		return 0;
+	
+	const Message &message = messages[item];
+	return (index == selectedIndex ? message.ExpandedLineCount() : message.LineCount());
+}
+
+
+
+// Update how many lines the message with the given index takes up. If the list
+// is about to be rebuilt, this is left for then.
+void Display::UpdateLineCount(int index)
+{
+	if(isViewChanged)
+		return;
+	int position = Position(index);
+	lineCounts.Set(position, LineCount(position));
 }
 
 
@@ -398,74 +1385,181 @@ void Display::ScrollDown()
 
 
 
-// Parse any messages from the process.
-void Display::ParseOutput()
+// Handle the parsed output that the worker thread has sent. Every record that
+// has been received is handled before the screen is redrawn, unless that takes
+// longer than the time budget for a single update.
+void Display::ReadOutput()
 {
-	// No need to do anything below this if the process is no longer running.
-	if(process.IsDone())
-		return;
-	
-	// If there's any error output, process it and then return.
-	string text = process.ReadError();
-	if(!text.empty())
+	const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for(int count = 1; ; ++count)
 	{
-		output.push_back(text);
-		
-		Message::Type type = Message::NONE;
-		// Ignore linker errors. Find "undefined reference" instead.
-		if(text.find(": error: ld returned") != string::npos)
-			type = Message::NONE;
-		else if(text.find(": undefined reference") != string::npos)
-			type = Message::LINK;
-		else if(text.find(": error: ") != string::npos)
-			type = Message::ERROR;
-		else if(text.find(": warning: ") != string::npos)
-			type = Message::WARNING;
-		++messageCount[type];
-	
-		if(type == Message::LINK)
-			messages.emplace_back(type, "Linker error:", text);
-		else if(type != Message::NONE)
-		{
-			// Parse this line and the one before it to see if the previous
-			// line is stating the location of the error.
-			size_t pos = text.find(':') + 1;
-			if(previousError.length() > pos
-					&& previousError[pos] == ' '
-					&& !text.compare(0, pos, previousError, 0, pos))
-				errorLocation = previousError.substr(pos + 1);
-			errorLinesAfter = 2;
-		
-			messages.emplace_back(type, errorLocation, text);
+		// Once all the records in a batch are handled, get the next batch. If
+		// there is none, all the available output has been handled.
+		if(batch && position == batch->Size())
+		{
+			worker.Release(batch);
+			batch = nullptr;
 		}
-		else if(errorLinesAfter)
+		if(!batch)
 		{
-			messages.back().AddText(text);
-			--errorLinesAfter;
+			batch = worker.Receive();
+			position = 0;
+			if(!batch)
+				break;
 		}
-		previousError = text;
-		return;
+		HandleRecord((*batch)[position++]);
+		isDirty = true;
+		
+		// Checking the clock is much slower than handling a record, so only
+		// check it periodically. Any records that are left over will be handled
+		// in the next update, because Wait() does not block if any are left.
+		if(!(count % PARSE_CHECK_INTERVAL) && chrono::steady_clock::now() - start > PARSE_BUDGET)
+			return;
 	}
-	// If there was no error output but there is regular output, process it and
-	// then return.
-	text = process.ReadOutput();
-	if(!text.empty())
+}
+
+
+
+// Handle one line of output, adding it to the messages if the parser says so.
+void Display::HandleRecord(const Record &record)
+{
+	// The previous build's messages are only shown until this one has some
+	// messages of its own, or turns out to have none.
+	if(isStale && record.action != Record::NONE)
+		ClearMessages();
+	
+	if(record.action == Record::DONE)
 	{
-		output.push_back(text);
-		if(!messages.empty())
-			title = text;
+		buildTime += chrono::steady_clock::now() - buildStart;
+		isBuilding = false;
+		// Save this build's messages for the next one to compare to, before
+		// adding the ones that it fixed.
+		if(!isCleaning && replayLog.empty())
+		{
+			messages.Save(CACHE_PATH);
+			AddFixed();
+		}
+		Finish();
+		if(server.HasSubscribers())
+			server.Broadcast(StatusLine());
 		return;
 	}
 	
-	// If this last set of reads was the last output, continue on from here.
-	if(!process.IsDone())
-		return;
-	
-	// If we got here, the process is done.
-	// Once we're done building, getch() can be called in blocking mode
-	// instead of polling mode.
-	nodelay(stdscr, false);
+	// A backtrace line is a copy of a line that was already output.
+	if(record.action != Record::BACKTRACE)
+		output.Add(record.text);
+	if(!record.isError && !messages.IsEmpty())
+		title = record.text;
 	
+	if(record.action == Record::MESSAGE)
+	{
+		Diagnostic diagnostic;
+		record.GetDiagnostic(diagnostic);
+		++messageCount[diagnostic.type];
+		// The parser only knows the translation unit for messages in headers.
+		string_view unit = (record.unit.empty() ? diagnostic.file : record.unit);
+		if(static_cast<size_t>(record.index) >= listIndex.size())
+			listIndex.resize(record.index + 1, -1);
+		
+		// If this exact message has been seen before, just count it again. The
+		// lines after it are ignored, since they will be the same as before.
+		pair<unordered_map<uint64_t, int>::iterator, bool> it = keyIndex.emplace(messages.Key(diagnostic), messages.Size());
+		if(!it.second)
+		{
+			int index = it.first->second;
+			messages.AddOccurrence(index, unit);
+			UpdateLineCount(index);
+			return;
+		}
+		int index = messages.Add(diagnostic, record.header, unit);
+		listIndex[record.index] = index;
+		AddToView(index);
+		++uniqueCount[diagnostic.type];
+		if(server.HasSubscribers())
+			server.Broadcast(RecordLine(json, record, index));
+		
+		// If there is a previous build to compare to, check whether it had this
+		// message too. It may have had the same message more than once.
+		if(hasPrevious)
+		{
+			unordered_map<uint64_t, int>::iterator it = unseen.find(messages[index].Key());
+			bool isPersisting = (it != unseen.end() && it->second > 0);
+			if(isPersisting)
+				--it->second;
+			messages.SetStatus(index, isPersisting ? Message::PERSISTING : Message::NEW);
+		}
+		
+		// Watch every file that a message refers to, even if it is outside the
+		// project. File IDs are given out in order, starting from zero.
+		if(watch)
+			for( ; watchedPaths <= messages[index].File(); ++watchedPaths)
+				watcher.WatchFile(string(messages.Path(watchedPaths)));
+		// Likewise, load each file in the background, so it can be previewed
+		// right away once its messages are selected.
+		if(showPreview)
+			for( ; prefetchedPaths <= messages[index].File(); ++prefetchedPaths)
+				sources.Prefetch(string(messages.Path(prefetchedPaths)));
+	}
+	else if(record.action == Record::TEXT || record.action == Record::BACKTRACE)
+	{
+		int index = (static_cast<size_t>(record.index) < listIndex.size() ? listIndex[record.index] : -1);
+		if(index < 0)
+			return;
+		messages.AddText(index, record.text, record.depth);
+		UpdateLineCount(index);
+		if(server.HasSubscribers())
+			server.Broadcast(RecordLine(json, record, index));
+	}
+}
+
+
+
+// Index the message that was just added, and add its lines to the screen unless
+// the filter hides it. The index covers the header and the diagnostic itself,
+// which is all that the filter searches.
+void Display::AddToView(int index)
+{
+	searchIndex.Add(index, messages.Header(index));
+	searchIndex.Add(index, messages.FirstLine(index));
+	bool isShown = (filter.IsEmpty() || filter.Matches(messages, index));
+	isHidden.push_back(!isShown);
+	shownCount += isShown;
+	// A new message usually goes at the end of the list, but if the messages
+	// are grouped, where it goes is only known once the list is rebuilt.
+	if(isGrouped)
+	{
+		groups.Add(messages, index);
+		isViewChanged = true;
+	}
+	else
+		lineCounts.Add(LineCount(index));
+}
+
+
+
+// Once a build is done, add the messages from the previous build that it did
+// not produce again, marked as fixed.
+void Display::AddFixed()
+{
+	for(int i = 0; i < previous.Size(); ++i)
+	{
+		int &count = unseen[previous[i].Key()];
+		if(count <= 0)
+			continue;
+		--count;
+		
+		int index = messages.Copy(previous, i);
+		messages.SetStatus(index, Message::FIXED);
+		AddToView(index);
+		++fixedCount;
+	}
+}
+
+
+
+// Update the title once the build is done.
+void Display::Finish()
+{
 	// If we're running a clean command, no need to summarize errors.
 	if(isCleaning)
 	{
@@ -492,6 +1586,111 @@ void Display::ParseOutput()
 		out << linkErrors << " link errors";
 	else
 		out << "no errors";
+	int total = 0;
+	int unique = 0;
+	for(const pair<const Message::Type, int> &it : messageCount)
+		total += it.second;
+	for(const pair<const Message::Type, int> &it : uniqueCount)
+		unique += it.second;
+	if(unique < total)
+		out << ", " << unique << " unique";
+	if(fixedCount)
+		out << ", " << fixedCount << " fixed";
 	out << ").";
 	title = out.str();
 }
+
+
+
+// Handle all the requests that have been received on the control socket. Each
+// one is answered with the state of the build once it has been handled.
+void Display::HandleRequests()
+{
+	Server::Request request;
+	while(server.NextRequest(request))
+	{
+		const string &command = request.command;
+		if(command == "build" || command == "clean")
+		{
+			isCleaning = (command == "clean");
+			Launch(isCleaning ? cleanCommand : buildCommand);
+		}
+		else if(command == "cancel")
+			Cancel();
+		else if(command != "status" && command != "subscribe")
+		{
+			json.Clear();
+			json.Add("type", "error");
+			json.Add("text", "Unknown command: " + command);
+			server.Send(request.client, json.Line());
+			continue;
+		}
+		server.Send(request.client, StatusLine());
+		
+		// A subscriber gets all the messages so far, and then every line of
+		// output that is added to a message from now on.
+		if(command == "subscribe")
+		{
+			SendMessages(request.client);
+			server.Subscribe(request.client);
+		}
+	}
+}
+
+
+
+// Send every line of every message so far to the given client.
+void Display::SendMessages(int client)
+{
+	for(int i = 0; i < messages.Size(); ++i)
+	{
+		const Message &message = messages[i];
+		int line = 0;
+		MessageList::Lines range = messages.Text(i);
+		for(MessageList::Lines::Iterator it = range.begin(); it != range.end(); ++it)
+		{
+			// The first line is the header, which is sent along with the second.
+			if(!line++)
+				continue;
+			json.Clear();
+			json.Add("index", i);
+			if(line == 2)
+				AddPosition(json, message.GetType(), messages.Header(i), messages.Path(message.File()),
+					message.Line(), message.Column());
+			else
+				json.Add("type", "text");
+			if(it.Depth())
+				json.Add("depth", it.Depth());
+			json.Add("text", *it);
+			server.Send(client, json.Line());
+		}
+	}
+}
+
+
+
+// Describe the state of the build as a line of JSON.
+const string &Display::StatusLine()
+{
+	const char *state = (isBuilding ? (isCleaning ? "cleaning" : "building") : (isCancelled ? "cancelled" : "done"));
+	json.Clear();
+	json.Add("type", "status");
+	json.Add("state", state);
+	json.Add("command", isCleaning ? cleanCommand : buildCommand);
+	json.Add("messages", messages.Size());
+	AddCounts();
+	return json.Line();
+}
+
+
+
+// Add the number of each type of message to the JSON object being built.
+void Display::AddCounts()
+{
+	json.Add("errors", messageCount[Message::ERROR]);
+	json.Add("warnings", messageCount[Message::WARNING]);
+	json.Add("linkErrors", messageCount[Message::LINK]);
+	json.Add("uniqueErrors", uniqueCount[Message::ERROR]);
+	json.Add("uniqueWarnings", uniqueCount[Message::WARNING]);
+	json.Add("uniqueLinkErrors", uniqueCount[Message::LINK]);
+}
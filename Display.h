@@ -8,11 +8,28 @@ keyboard events to let the user select an error to view.
 #ifndef DISPLAY_H_
 #define DISPLAY_H_
 
+#include "Editor.h"
+#include "FileGroups.h"
+#include "Filter.h"
+#include "JsonWriter.h"
+#include "LineCounts.h"
 #include "Message.h"
-#include "Process.h"
+#include "MessageList.h"
+#include "OutputLog.h"
+#include "Record.h"
+#include "SearchIndex.h"
+#include "Server.h"
+#include "SourceCache.h"
+#include "Watcher.h"
+#include "Worker.h"
 
+#include <chrono>
+#include <cstdint>
 #include <map>
+#include <ostream>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 using namespace std;
@@ -20,31 +37,113 @@ using namespace std;
 
 
 class Display {
+private:
+	// The contents of one row of the screen, as of when it was last drawn.
+	class Row {
+	public:
+		int attributes = -1;
+		string text;
+	};
+	
+	
 public:
-	// Initialize the display (and begin the build).
-	void Init(bool displayCommands);
-	// Redraw the screen, then wait for the next event or input from the build
-	// process and handle it appropriately. Return false if it's time to quit.
+	// Replay the given build log, paced by the given timing file (if any),
+	// instead of running the build or clean command. This must be called before
+	// Init() or Batch().
+	void SetReplay(const string &log, const string &timing);
+	// Rebuild automatically whenever a source file changes.
+	void SetWatch();
+	// Initialize the display (and begin the build). In batch mode, only the
+	// commands are loaded, and the build is started by Batch() instead.
+	void Init(bool displayCommands, bool isBatch);
+	// Handle any pending input and build output, redraw the screen, then wait
+	// until there is more input, more output from the build process, or a
+	// signal. Return false if it's time to quit.
 	bool Update();
 	// Clean up, returning the terminal to "cooked" mode.
 	void Cleanup();
 	
+	// Run the build without using the terminal, printing each message to STDOUT
+	// as a line of JSON as soon as it has been parsed, followed by a summary.
+	// Return the exit status: 1 if there were any errors, or 0 otherwise.
+	int Batch();
+	
+	// Print statistics about how much work gorp did and how much memory it is
+	// using, to tell whether gorp or the build is responsible for slowness.
+	void PrintStats(ostream &out) const;
+	
 	
 private:
 	// Check for a .gorp file specifying the commands to use.
 	void LoadCommands(const string &path);
 	// Launch the given command, after cleaning up previous data.
 	void Launch(const string &command);
+	// Remove all the messages.
+	void ClearMessages();
+	// Start the worker running the given command, or replaying the log if there
+	// is one.
+	void StartWorker(const string &command);
+	// Stop the current command, keeping whatever output has been handled.
+	void Cancel();
+	// Block until keyboard or mouse input, build output, a request on the
+	// control socket, or a signal arrives, or until the given timeout (in
+	// milliseconds) if it is not negative.
+	void Wait(int timeout);
+	// Handle a change in the size of the terminal.
+	void Resize();
 	
-	// Display the messages.
+	// Display the messages. DrawOutput() and DrawErrors() return the index of
+	// the first line on the screen below what they drew.
 	void Draw();
-	void DrawOutput();
-	void DrawErrors();
-	void DrawText(string text, int line);
+	int DrawOutput();
+	int DrawErrors();
+	// Draw the source code around the selected message, starting on the given
+	// line, and return the index of the first line below what it drew.
+	int DrawPreview(int line);
+	void DrawText(string_view text, int line, int attributes);
+	// Get the header row for the given group of messages.
+	string GroupHeader(int group) const;
+	// Get the statistics to show in the title row.
+	string StatsText() const;
+	// Get the filter to show in the title row, if there is one.
+	string FilterText() const;
+	// If it is time to, sample how fast the build output is being read, and
+	// return the time until the next sample (in milliseconds).
+	int UpdateStats();
 	
-	// Handle keyboard and mouse events. This returns false if a quit event is
-	// received.
+	// Handle all queued keyboard and mouse events. This returns false if a quit
+	// event is received.
 	bool HandleEvents();
+	// Scroll the build output in response to the given key. Return false if
+	// that key does not scroll.
+	bool ScrollOutput(int input);
+	// Handle a key pressed while the filter is being typed. Return false if the
+	// key is not part of the filter, so it should be handled as usual.
+	bool EditFilter(int input);
+	// Apply the filter to all the messages, after it has changed.
+	void ApplyFilter();
+	// Switch between listing the messages in the order they arrived in and
+	// grouping them by file.
+	void ToggleGroups();
+	// Collapse or expand the given group of messages.
+	void ToggleGroup(int group);
+	// If messages have been added to the groups since the list was last built,
+	// rebuild it, keeping the same items selected and at the top of the screen.
+	void UpdateView();
+	// Recount how many lines of the screen every item in the list takes up.
+	void CountLines();
+	// Get what is shown at the given index in the list: a message index, or -1
+	// minus the index of a group whose header is shown there. Until messages
+	// are grouped, the two are the same. Position() does the reverse.
+	int Item(int index) const;
+	int Position(int item) const;
+	// Get the number of lines of the screen the preview takes up, and the index
+	// of the first line below the list of messages, where the preview starts.
+	int PreviewHeight() const;
+	int ListEnd() const;
+	// Start loading the source files of the item with the given index in the
+	// list and the ones next to it, which may be selected next.
+	void PrefetchAround(int index);
 	// Get the index of the last visible message.
 	int LastVisibleIndex() const;
 	// Get the maximum scroll index. This is the lowest index where the last
@@ -55,40 +154,164 @@ private:
 	int LineIndex(int line) const;
 	// Get the index of the message that's a page before the given index.
 	int PageBefore(int index) const;
+	// Get the index of the shown message nearest to the given index, looking
+	// after it first. If the filter hides every message, return -1.
+	int NearestShown(int index) const;
+	// Select the message with the given index, or none if the index is -1. The
+	// selected message is expanded to show all of its lines.
+	void Select(int index);
+	// Get how many lines of the screen the item with the given index takes up,
+	// which depends on whether it is selected and whether it is hidden.
+	int LineCount(int index) const;
+	// Update how many lines the message with the given index takes up, after
+	// lines have been added to it.
+	void UpdateLineCount(int index);
 	// Scroll up or down, always by a full page.
 	void ScrollUp();
 	void ScrollDown();
 	
-	// Parse any messages from the process.
-	void ParseOutput();
+	// Handle the parsed output that the worker thread has sent.
+	void ReadOutput();
+	// Handle one line of output, adding it to the messages if the parser says so.
+	void HandleRecord(const Record &record);
+	// Index the message that was just added, and add its lines to the screen
+	// unless the filter hides it.
+	void AddToView(int index);
+	// Once a build is done, add the messages from the previous build that it
+	// did not produce again, marked as fixed.
+	void AddFixed();
+	// Update the title once the build is done.
+	void Finish();
+	
+	// Handle all the requests that have been received on the control socket.
+	void HandleRequests();
+	// Send every line of every message so far to the given client.
+	void SendMessages(int client);
+	// Describe the state of the build as a line of JSON.
+	const string &StatusLine();
+	// Add the number of each type of message to the JSON object being built.
+	void AddCounts();
 	
 	
 private:
-	// Object for handling the current child process.
-	Process process;
+	// Object for running the current child process and parsing its output.
+	Worker worker;
+	// The batch of parsed output currently being handled, and the index of the
+	// next record in it to handle.
+	RecordBatch *batch = nullptr;
+	size_t position = 0;
 	string buildCommand = "make";
 	string cleanCommand = "make clean";
 	string editCommand = "gedit FILE +LINE:COLUMN";
+	Editor editor;
+	// The compiler flag for the diagnostics format, if not the default.
+	string diagnosticsFlag;
+	// The build log to replay instead of running the commands, if any.
+	string replayLog;
+	string replayTiming;
 	bool isCleaning = false;
+	bool isCancelled = false;
+	
+	// Watcher for changes to the source files, if watch mode is on. Once a change
+	// is seen, the build is restarted after a short delay, so that a burst of
+	// changes (e.g. saving every open file) only restarts it once.
+	Watcher watcher;
+	bool watch = false;
+	bool hasChanged = false;
+	chrono::steady_clock::time_point rebuildTime;
+	// How many of the messages' file paths have been added to the watcher.
+	int watchedPaths = 0;
+	
+	// Socket that other programs can use to control the build and to read the
+	// messages, and the object used to format what is sent to them.
+	Server server;
+	JsonWriter json;
+	// The file descriptors that Wait() polls, kept so they are not reallocated.
+	vector<pollfd> fds;
 	
 	// Parsed output:
 	string title;
-	vector<Message> messages;
+	MessageList messages;
+	// How many lines of the screen each message takes up. A message that the
+	// filter hides takes up none.
+	LineCounts lineCounts;
+	// The filter that the user has typed, which messages it hides, and how
+	// many it shows. The search index lets it skip messages that cannot match.
+	string filterQuery;
+	Filter filter;
+	SearchIndex searchIndex;
+	vector<bool> isHidden;
+	int shownCount = 0;
+	bool isEditingFilter = false;
+	// Whether the messages are grouped by file, and the groups. The groups are
+	// only kept while the messages are grouped, and the list of what is shown
+	// at each index is only rebuilt when it is about to be used.
+	bool isGrouped = false;
+	FileGroups groups;
+	bool isViewChanged = false;
+	
+	// Whether to show the source code around the selected message, and the
+	// source files that are loaded to show it. As messages arrive, the files
+	// they refer to are loaded in the background, in order of their file IDs.
+	bool showPreview = false;
+	SourceCache sources;
+	int prefetchedPaths = 0;
+	// How many messages of each type the build has produced, and how many of
+	// them were distinct. A message that is repeated (e.g. a warning in a header
+	// that many files include) is only listed once, so the index of the message
+	// with each key is kept, along with where in the list each message the
+	// parser found ended up (or -1 if it was a repeat).
 	map<Message::Type, int> messageCount;
-	vector<string> output;
+	map<Message::Type, int> uniqueCount;
+	unordered_map<uint64_t, int> keyIndex;
+	vector<int> listIndex;
+	OutputLog output;
 	
-	// Helper variables for parsing:
-	string errorLocation;
-	string previousError;
-	int errorLinesAfter = 0;
+	// The messages from the last build that finished, as saved in the cache,
+	// and how many of the messages with each key the current build has not
+	// produced yet. Once it is done, any that are left are shown as fixed.
+	MessageList previous;
+	unordered_map<uint64_t, int> unseen;
+	bool hasPrevious = false;
+	int fixedCount = 0;
+	// Until the current build produces a message, the previous build's messages
+	// are shown instead.
+	bool isStale = false;
 	
-	// The index of the currently selected message:
+	// The index in the list of the currently selected item:
 	int selectedIndex = -1;
-	// The current scroll position:
+	// The current scroll position, as an index in the list:
 	int scrollIndex = 0;
+	// The first line of output to display, or -1 to show the most recent.
+	long outputScroll = -1;
 	// The size of the screen:
 	int lines = 0;
 	int columns = 0;
+	
+	// What is currently drawn on each row of the screen:
+	vector<Row> rows;
+	// The screen only needs to be redrawn if something has changed since the
+	// last frame, and frames are never drawn more often than frameInterval.
+	bool isDirty = true;
+	chrono::steady_clock::duration frameInterval = chrono::microseconds(1000000 / 30);
+	chrono::steady_clock::time_point lastFrame;
+	
+	// Performance statistics, and whether to show them in the title row:
+	bool showStats = false;
+	// How fast lines of output were read as of the last sample.
+	chrono::steady_clock::time_point sampleTime;
+	uint64_t sampleLines = 0;
+	double lineRate = 0.;
+	// How long has been spent running builds, not counting the current one.
+	chrono::steady_clock::duration buildTime = chrono::steady_clock::duration::zero();
+	chrono::steady_clock::time_point buildStart;
+	bool isBuilding = false;
+	// How many frames were drawn and how long they took, and how many times a
+	// frame was delayed because the last one was too recent.
+	int framesDrawn = 0;
+	int framesSkipped = 0;
+	chrono::steady_clock::duration frameTime = chrono::steady_clock::duration::zero();
+	chrono::steady_clock::duration maxFrameTime = chrono::steady_clock::duration::zero();
 };
 
 
@@ -0,0 +1,271 @@
+/* Editor.cpp
+Michael Zahniser, 17 Oct 2026
+*/
+
+#include "Editor.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+extern char **environ;
+
+namespace {
+	// The placeholders that are replaced in each argument of the command.
+	enum Placeholder {FILE_NAME, LINE, COLUMN, SOCKET};
+	const string_view PLACEHOLDERS[] = {"FILE", "LINE", "COLUMN", "SOCKET"};
+	
+	// Split a command into arguments. Arguments are separated by whitespace,
+	// unless they are in single or double quotes.
+	vector<string> Split(const string &command)
+	{
+		vector<string> args;
+		size_t pos = 0;
+		while(true)
+		{
+			// Skip whitespace. If that reaches the end of the string, bail out.
+			while(pos < command.size() && command[pos] <= ' ')
+				++pos;
+			if(pos == command.size())
+				break;
+			
+			// If this is a quotation mark, the argument ends at the matching one.
+			char mark = command[pos];
+			if(mark == '"' || mark == '\'')
+				++pos;
+			else
+				mark = ' ';
+			size_t end = (mark == ' ' ? command.find_first_of(" \t\r\n", pos) : command.find(mark, pos));
+			end = min(end, command.size());
+			args.emplace_back(command, pos, end - pos);
+			pos = min(end + 1, command.size());
+		}
+		return args;
+	}
+	
+	// Replace each placeholder in the given argument with its value. This is
+	// done in a single pass, so a value that happens to contain the name of a
+	// placeholder (e.g. a path with "LINE" in it) is left alone.
+	string Substitute(const string &arg, const string *values)
+	{
+		string result;
+		for(size_t pos = 0; pos < arg.size(); )
+		{
+			int found = -1;
+			for(int i = 0; i < 4 && found < 0; ++i)
+				if(!arg.compare(pos, PLACEHOLDERS[i].size(), PLACEHOLDERS[i]))
+					found = i;
+			if(found < 0)
+				result += arg[pos++];
+			else
+			{
+				result += values[found];
+				pos += PLACEHOLDERS[found].size();
+			}
+		}
+		return result;
+	}
+	
+	// Append a string to a message in the MessagePack format.
+	void Pack(string &message, string_view text)
+	{
+		size_t size = text.size();
+		if(size < 32)
+			message += static_cast<char>(0xA0 | size);
+		else if(size < 0x100)
+		{
+			message += '\xD9';
+			message += static_cast<char>(size);
+		}
+		else if(size < 0x10000)
+		{
+			message += '\xDA';
+			message += static_cast<char>(size >> 8);
+			message += static_cast<char>(size);
+		}
+		else
+		{
+			message += '\xDB';
+			for(int shift = 24; shift >= 0; shift -= 8)
+				message += static_cast<char>(size >> shift);
+		}
+		message.append(text);
+	}
+	
+	// Quote a string for use in a Vim script command.
+	string Quote(const string &text)
+	{
+		string result = "'";
+		for(char c : text)
+		{
+			if(c == '\'')
+				result += c;
+			result += c;
+		}
+		return result + '\'';
+	}
+}
+
+
+
+// Close the connection to the editor. The editor itself keeps running.
+Editor::~Editor()
+{
+	if(connection >= 0)
+		close(connection);
+}
+
+
+
+// Set the command to run.
+void Editor::SetCommand(const string &command, const string &socketPath)
+{
+	args = Split(command);
+	this->socketPath = socketPath;
+	hasSocket = false;
+	for(const string &arg : args)
+		hasSocket |= (arg.find(PLACEHOLDERS[SOCKET]) != string::npos);
+}
+
+
+
+// Open the given file at the given position.
+void Editor::Open(const string &path, int line, int column)
+{
+	line = max(1, line);
+	column = max(1, column);
+	if(!hasSocket || !Send(path, line, column))
+		Spawn(path, line, column);
+}
+
+
+
+// Check whether any of the editors that have been started have exited.
+void Editor::Reap()
+{
+	for(size_t i = 0; i < children.size(); )
+	{
+		if(waitpid(children[i], nullptr, WNOHANG))
+		{
+			children[i] = children.back();
+			children.pop_back();
+		}
+		else
+			++i;
+	}
+}
+
+
+
+// Send a command to open the file to the editor that is already running.
+// Return false if there is no editor to send it to.
+bool Editor::Send(const string &path, int line, int column)
+{
+	// A path with a newline in it cannot be given in a Vim command.
+	if(path.find('\n') != string::npos)
+		return false;
+	
+	// The editor may be running in some other directory.
+	string absolute = path;
+	if(path.front() != '/')
+	{
+		char *cwd = getcwd(nullptr, 0);
+		if(cwd)
+			absolute = cwd + ("/" + path);
+		free(cwd);
+	}
+	
+	// The message is a notification, [2, method, [arguments]], so the editor
+	// does not send a reply. (It does send a notification if the command fails,
+	// but those are just discarded.)
+	message.assign("\x93\x02", 2);
+	Pack(message, "nvim_command");
+	message += '\x91';
+	Pack(message, "execute 'edit' fnameescape(" + Quote(absolute) + ") | call cursor("
+		+ to_string(line) + ", " + to_string(column) + ")");
+	
+	// Try the existing connection first. If the editor was closed since it was
+	// used, try connecting again, in case some other editor is listening now.
+	for(int attempt = 0; attempt < 2; ++attempt)
+	{
+		if(connection < 0)
+		{
+			sockaddr_un address = {};
+			address.sun_family = AF_UNIX;
+			if(socketPath.size() >= sizeof(address.sun_path))
+				return false;
+			memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+			
+			connection = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+			if(connection < 0)
+				return false;
+			if(connect(connection, reinterpret_cast<sockaddr *>(&address), sizeof(address)))
+			{
+				close(connection);
+				connection = -1;
+				return false;
+			}
+		}
+		
+		// Discard anything the editor has sent, so its buffer never fills up.
+		char buffer[4096];
+		while(recv(connection, buffer, sizeof(buffer), 0) > 0)
+			continue;
+		
+		if(send(connection, message.data(), message.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(message.size()))
+			return true;
+		close(connection);
+		connection = -1;
+	}
+	return false;
+}
+
+
+
+// Start a new editor, with the file as one of its arguments.
+void Editor::Spawn(const string &path, int line, int column)
+{
+	if(args.empty())
+		return;
+	
+	// Nothing is listening on the socket, so if it exists, it is left over from
+	// an editor that has exited, and would keep the new one from listening.
+	if(hasSocket)
+		unlink(socketPath.c_str());
+	
+	const string values[] = {path, to_string(line), to_string(column), socketPath};
+	vector<string> substituted;
+	for(const string &arg : args)
+		substituted.push_back(Substitute(arg, values));
+	vector<char *> argv;
+	for(string &arg : substituted)
+		argv.push_back(&arg[0]);
+	argv.push_back(nullptr);
+	
+	// Anything the editor prints would be drawn over the display, so its output
+	// is discarded. It is also put in its own session, so that it does not get
+	// any signals meant for this program, and outlives it.
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	for(int fd = 0; fd < 3; ++fd)
+		posix_spawn_file_actions_addopen(&actions, fd, "/dev/null", fd ? O_WRONLY : O_RDONLY, 0);
+	posix_spawnattr_t attributes;
+	posix_spawnattr_init(&attributes);
+	posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSID);
+	
+	pid_t child;
+	if(!posix_spawnp(&child, argv[0], &actions, &attributes, &argv[0], environ))
+		children.push_back(child);
+	
+	posix_spawnattr_destroy(&attributes);
+	posix_spawn_file_actions_destroy(&actions);
+}
@@ -0,0 +1,67 @@
+/* Editor.h
+Michael Zahniser, 17 Oct 2026
+
+Class for opening files in the user's text editor. The edit command is split
+into arguments once, and the editor is started directly rather than through a
+shell, so file names never need to be escaped. If the command contains the
+SOCKET placeholder, the editor is assumed to be Neovim listening on that
+socket: it is only started once, and after that files are opened by sending
+it commands over a connection that is kept open.
+*/
+
+#ifndef EDITOR_H_
+#define EDITOR_H_
+
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+using namespace std;
+
+
+
+class Editor {
+public:
+	Editor() = default;
+	Editor(const Editor &) = delete;
+	Editor &operator=(const Editor &) = delete;
+	// Close the connection to the editor. The editor itself keeps running.
+	~Editor();
+	
+	// Set the command to run. "FILE", "LINE", "COLUMN", and "SOCKET" in it are
+	// replaced with the file path, the position in the file, and the path of
+	// the given socket.
+	void SetCommand(const string &command, const string &socketPath);
+	// Open the given file at the given position. If the line or column is not
+	// known, it should be 0 or less.
+	void Open(const string &path, int line, int column);
+	// Check whether any of the editors that have been started have exited, so
+	// that they do not linger as zombie processes.
+	void Reap();
+	
+	
+private:
+	// Send a command to open the file to the editor that is already running.
+	// Return false if there is no editor to send it to.
+	bool Send(const string &path, int line, int column);
+	// Start a new editor, with the file as one of its arguments.
+	void Spawn(const string &path, int line, int column);
+	
+	
+private:
+	// The command, split into arguments, with the placeholders still in them.
+	vector<string> args;
+	string socketPath;
+	bool hasSocket = false;
+	// The connection to the editor, if it is open.
+	int connection = -1;
+	// Editors that have been started and have not exited yet.
+	vector<pid_t> children;
+	// Buffer for building the messages sent to the editor.
+	string message;
+};
+
+
+
+#endif
@@ -0,0 +1,161 @@
+/* FileGroups.cpp
+Michael Zahniser, 17 Oct 2026
+*/
+
+#include "FileGroups.h"
+
+#include <algorithm>
+
+using namespace std;
+
+
+
+// Remove all the messages and groups.
+void FileGroups::Clear()
+{
+	groups.clear();
+	order.clear();
+	fileGroups.clear();
+	messageGroups.clear();
+	positions.clear();
+	items.clear();
+}
+
+
+
+// Add the message with the given index to the group for its file.
+void FileGroups::Add(const MessageList &messages, int index)
+{
+	const Message &message = messages[index];
+	int file = message.File();
+	if(file + 1 >= static_cast<int>(fileGroups.size()))
+		fileGroups.resize(file + 2, -1);
+	
+	// If this is the first message in its file, add a group for it, keeping
+	// the groups in order of their paths. Messages with no file come last.
+	int &group = fileGroups[file + 1];
+	if(group < 0)
+	{
+		group = groups.size();
+		groups.emplace_back();
+		groups.back().file = file;
+		vector<int>::iterator it = upper_bound(order.begin(), order.end(), group, [&](int a, int b)
+		{
+			int fileA = groups[a].file;
+			int fileB = groups[b].file;
+			if(fileA < 0 || fileB < 0)
+				return (fileB < 0 && fileA >= 0);
+			return messages.Path(fileA) < messages.Path(fileB);
+		});
+		order.insert(it, group);
+	}
+	
+	// Messages at the same position stay in the order they were added in.
+	Bucket &bucket = groups[group];
+	vector<int>::iterator pos = upper_bound(bucket.messages.begin(), bucket.messages.end(), index, [&](int a, int b)
+	{
+		const Message &first = messages[a];
+		const Message &second = messages[b];
+		if(first.Line() != second.Line())
+			return first.Line() < second.Line();
+		return first.Column() < second.Column();
+	});
+	bucket.messages.insert(pos, index);
+	if(message.GetType() < Message::NONE)
+		++bucket.counts[message.GetType()];
+	messageGroups.push_back(group);
+	positions.push_back(-1);
+}
+
+
+
+// Rebuild the list of what is shown at each position.
+void FileGroups::Build()
+{
+	items.clear();
+	for(int group : order)
+	{
+		Bucket &bucket = groups[group];
+		bucket.position = items.size();
+		items.push_back(-1 - group);
+		for(int index : bucket.messages)
+		{
+			positions[index] = items.size();
+			items.push_back(index);
+		}
+	}
+}
+
+
+
+// Get the number of positions in the list.
+int FileGroups::Size() const
+{
+	return items.size();
+}
+
+
+
+// Get what is shown at the given position.
+int FileGroups::Item(int position) const
+{
+	return items[position];
+}
+
+
+
+// Get the position of the given item, or -1 if it is not in the list yet.
+int FileGroups::Position(int item) const
+{
+	if(item < 0)
+		return groups[-1 - item].position;
+	return (item < static_cast<int>(positions.size()) ? positions[item] : -1);
+}
+
+
+
+// Get the group that the message with the given index is in.
+int FileGroups::Group(int index) const
+{
+	return messageGroups[index];
+}
+
+
+
+// Get the file of the given group.
+int FileGroups::File(int group) const
+{
+	return groups[group].file;
+}
+
+
+
+// Get the messages in the given group, in order of line and column.
+const vector<int> &FileGroups::Messages(int group) const
+{
+	return groups[group].messages;
+}
+
+
+
+// Get how many of the messages in the given group are of the given type.
+int FileGroups::Count(int group, Message::Type type) const
+{
+	return (type < Message::NONE ? groups[group].counts[type] : 0);
+}
+
+
+
+// Check whether the given group is collapsed.
+bool FileGroups::IsCollapsed(int group) const
+{
+	return groups[group].isCollapsed;
+}
+
+
+
+// Collapse or expand the given group.
+void FileGroups::SetCollapsed(int group, bool isCollapsed)
+{
+	groups[group].isCollapsed = isCollapsed;
+}
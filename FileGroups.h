@@ -0,0 +1,86 @@
+/* FileGroups.h
+Michael Zahniser, 17 Oct 2026
+
+Class that sorts messages into a group for each file, for showing all the
+messages in a file together even if a parallel build produced them at different
+times. The groups are in order of their file paths, and the messages in each
+group are in order of line and column. Each message is put in its place as it
+is added, so nothing is ever sorted all at once; only the list of what is shown
+at each position is rebuilt, and only when it is asked for.
+*/
+
+#ifndef FILE_GROUPS_H_
+#define FILE_GROUPS_H_
+
+#include "Message.h"
+#include "MessageList.h"
+
+#include <vector>
+
+using namespace std;
+
+
+
+class FileGroups {
+public:
+	// Remove all the messages and groups.
+	void Clear();
+	// Add the message with the given index to the group for its file. Messages
+	// must be added in order of their indices.
+	void Add(const MessageList &messages, int index);
+	
+	// Rebuild the list of what is shown at each position: each group's header,
+	// followed by its messages. This must be done after adding messages, before
+	// Item() or Position() is used.
+	void Build();
+	// Get the number of positions in the list.
+	int Size() const;
+	// Get what is shown at the given position: either the index of a message,
+	// or, for a group's header, -1 minus the index of the group.
+	int Item(int position) const;
+	// Get the position of the given item, or -1 if it is not in the list yet.
+	int Position(int item) const;
+	
+	// Get the group that the message with the given index is in.
+	int Group(int index) const;
+	// Get the file of the given group, its messages, and how many of them are
+	// of the given type.
+	int File(int group) const;
+	const vector<int> &Messages(int group) const;
+	int Count(int group, Message::Type type) const;
+	// Check or change whether the given group is collapsed, hiding its messages.
+	bool IsCollapsed(int group) const;
+	void SetCollapsed(int group, bool isCollapsed);
+	
+	
+private:
+	// The messages in one file, and how many there are of each type.
+	class Bucket {
+	public:
+		int file = -1;
+		// The messages in this group, in order of line and column.
+		vector<int> messages;
+		int counts[Message::NONE] = {};
+		bool isCollapsed = false;
+		// The position of this group's header in the list.
+		int position = -1;
+	};
+	
+	
+private:
+	vector<Bucket> groups;
+	// The groups, in order of their file paths.
+	vector<int> order;
+	// The group for each file ID, offset by one so that messages with no file
+	// have a group too.
+	vector<int> fileGroups;
+	// The group that each message is in, and its position in the list.
+	vector<int> messageGroups;
+	vector<int> positions;
+	// What is shown at each position in the list.
+	vector<int> items;
+};
+
+
+
+#endif
@@ -0,0 +1,210 @@
+/* Filter.cpp
+Michael Zahniser, 17 Oct 2026
+*/
+
+#include "Filter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+
+#include <fnmatch.h>
+
+using namespace std;
+
+namespace {
+	// The names of the message types, in the order of Message::Type.
+	const string_view TYPE_NAMES[] = {"warning", "error", "link"};
+	// The characters that have a special meaning in a regular expression. Text
+	// with none of them in it is searched for as it is, which is much faster.
+	const string_view SPECIAL = ".[]{}()*+?^$|\\";
+	
+	// Get the longest piece of plain text that any match of the given regular
+	// expression must contain. Text inside a group, or followed by something
+	// that makes it optional, may not be in the match.
+	string Literal(const string &pattern)
+	{
+		if(pattern.find('|') != string::npos)
+			return string();
+		
+		string longest;
+		string current;
+		int depth = 0;
+		for(size_t i = 0; i < pattern.size(); ++i)
+		{
+			char c = pattern[i];
+			bool isOptional = (i + 1 < pattern.size() && (pattern[i + 1] == '?' || pattern[i + 1] == '*' || pattern[i + 1] == '{'));
+			if(!depth && !isOptional && SPECIAL.find(c) == string_view::npos)
+			{
+				current += c;
+				continue;
+			}
+			
+			if(current.size() > longest.size())
+				longest = current;
+			current.clear();
+			// Skip over whatever the special character applies to.
+			if(c == '\\')
+				++i;
+			else if(c == '[')
+				i = min(pattern.find(']', i + 2), pattern.size());
+			else if(c == '(')
+				++depth;
+			else if(c == ')')
+				depth = max(0, depth - 1);
+		}
+		return (current.size() > longest.size() ? current : longest);
+	}
+}
+
+
+
+// Set the query. An empty query matches everything.
+void Filter::Set(const string &query)
+{
+	types = 0;
+	globs.clear();
+	terms.clear();
+	bool hasTypes = false;
+	for(size_t pos = query.find_first_not_of(' '); pos != string::npos; pos = query.find_first_not_of(' ', pos))
+	{
+		size_t end = min(query.find(' ', pos), query.size());
+		string term = query.substr(pos, end - pos);
+		pos = end;
+		
+		if(!term.compare(0, 5, "type:"))
+		{
+			// Any type whose name starts with the given text is included.
+			hasTypes = true;
+			string_view name = string_view(term).substr(5);
+			for(int type = 0; type < Message::NONE; ++type)
+				if(!name.empty() && !TYPE_NAMES[type].compare(0, name.size(), name))
+					types |= (1 << type);
+		}
+		else if(!term.compare(0, 5, "path:"))
+		{
+			string glob = term.substr(5);
+			if(glob.find_first_of("*?[") == string::npos)
+				glob = '*' + glob + '*';
+			globs.push_back(glob);
+		}
+		else
+		{
+			terms.emplace_back();
+			Term &it = terms.back();
+			it.text = term;
+			// If the text is not a valid regular expression, it is probably only
+			// partly typed, so in the meantime it is treated as plain text.
+			if(term.find_first_of(SPECIAL) != string::npos)
+			{
+				regex_t *pattern = new regex_t;
+				if(!regcomp(pattern, term.c_str(), REG_EXTENDED | REG_ICASE | REG_NOSUB))
+					it.pattern.reset(pattern, [](regex_t *compiled)
+					{
+						regfree(compiled);
+						delete compiled;
+					});
+				else
+					delete pattern;
+			}
+			it.literal = (it.pattern ? Literal(term) : term);
+		}
+	}
+	if(!hasTypes)
+		types = (1 << Message::NONE) - 1;
+	isEmpty = (!hasTypes && globs.empty() && terms.empty());
+}
+
+
+
+bool Filter::IsEmpty() const
+{
+	return isEmpty;
+}
+
+
+
+// Check which of the messages match, and return how many do.
+int Filter::Apply(const MessageList &messages, const SearchIndex &index, vector<bool> &isHidden) const
+{
+	isHidden.assign(messages.Size(), !isEmpty);
+	if(isEmpty)
+		return messages.Size();
+	
+	// A message can only match if it contains the plain text of every term.
+	vector<int> candidates;
+	vector<int> found;
+	vector<int> intersection;
+	bool hasCandidates = false;
+	for(const Term &term : terms)
+	{
+		if(!index.Find(term.literal, found))
+			continue;
+		if(hasCandidates)
+		{
+			intersection.clear();
+			set_intersection(candidates.begin(), candidates.end(), found.begin(), found.end(),
+				back_inserter(intersection));
+			found.swap(intersection);
+		}
+		candidates.swap(found);
+		hasCandidates = true;
+	}
+	
+	int count = 0;
+	for(int i = 0; i < (hasCandidates ? static_cast<int>(candidates.size()) : messages.Size()); ++i)
+	{
+		int message = (hasCandidates ? candidates[i] : i);
+		isHidden[message] = !Matches(messages, message);
+		count += !isHidden[message];
+	}
+	return count;
+}
+
+
+
+// Check whether the message with the given index matches.
+bool Filter::Matches(const MessageList &messages, int index) const
+{
+	const Message &message = messages[index];
+	if(!(types & (1 << message.GetType())))
+		return false;
+	
+	if(!globs.empty())
+	{
+		string path(messages.Path(message.File()));
+		bool isFound = false;
+		for(const string &glob : globs)
+			isFound |= !fnmatch(glob.c_str(), path.c_str(), 0);
+		if(!isFound)
+			return false;
+	}
+	
+	// The text is searched for in the header and in the first line after it.
+	string_view header = messages.Header(index);
+	string_view first = messages.FirstLine(index);
+	for(const Term &term : terms)
+		if(!Matches(term, header) && !Matches(term, first))
+			return false;
+	return true;
+}
+
+
+
+// Check whether the given text matches a term.
+bool Filter::Matches(const Term &term, string_view text)
+{
+	// The text is not null-terminated, so its end is given in the match range.
+	if(term.pattern)
+	{
+		regmatch_t range;
+		range.rm_so = 0;
+		range.rm_eo = text.size();
+		return !regexec(term.pattern.get(), text.empty() ? "" : text.data(), 1, &range, REG_STARTEND);
+	}
+	
+	return search(text.begin(), text.end(), term.text.begin(), term.text.end(), [](char a, char b)
+	{
+		return tolower(static_cast<unsigned char>(a)) == tolower(static_cast<unsigned char>(b));
+	}) != text.end();
+}
@@ -0,0 +1,75 @@
+/* Filter.h
+Michael Zahniser, 17 Oct 2026
+
+Class for narrowing the list of messages down to the ones matching a query. The
+query is a list of terms separated by spaces:
+  type:<type>   only errors, warnings, or link errors ("type:err" is enough)
+  path:<glob>   only messages in files whose path matches the glob; a glob with
+                no wildcards in it matches any path that contains it
+  <text>        only messages whose header or first line contains the text, or
+                matches it if it is a regular expression (ignoring case)
+If there are several type or path terms, a message only has to match one of
+them, but it has to match every text term.
+*/
+
+#ifndef FILTER_H_
+#define FILTER_H_
+
+#include "MessageList.h"
+#include "SearchIndex.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <regex.h>
+
+using namespace std;
+
+
+
+class Filter {
+public:
+	// Set the query. An empty query matches everything.
+	void Set(const string &query);
+	bool IsEmpty() const;
+	
+	// Check which of the messages match, and return how many do. The index is
+	// used to skip messages that cannot contain the text being searched for.
+	int Apply(const MessageList &messages, const SearchIndex &index, vector<bool> &isHidden) const;
+	// Check whether the message with the given index matches.
+	bool Matches(const MessageList &messages, int index) const;
+	
+	
+private:
+	// Text that must be found in each message, either as a regular expression
+	// or as plain text. Either way, the longest piece of plain text that any
+	// match must contain is kept, for looking up in the search index. POSIX
+	// regular expressions are used because std::regex recurses once for each
+	// character it matches, and can run out of stack on a very long line. The
+	// compiled expression is shared, because a regex_t cannot be copied.
+	class Term {
+	public:
+		string text;
+		shared_ptr<regex_t> pattern;
+		string literal;
+	};
+	
+	
+private:
+	// Check whether the given text matches a term.
+	static bool Matches(const Term &term, string_view text);
+	
+	
+private:
+	bool isEmpty = true;
+	// Which types of message are shown, as a mask of Message::Type bits.
+	int types = 0;
+	vector<string> globs;
+	vector<Term> terms;
+};
+
+
+
+#endif
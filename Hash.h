@@ -0,0 +1,33 @@
+/* Hash.h
+Michael Zahniser, 17 Oct 2026
+
+Function for hashing text that is saved to disk or shared with other processes,
+which needs a hash that is the same every time the program runs (unlike the
+standard library's hashes, which are allowed to change).
+*/
+
+#ifndef HASH_H_
+#define HASH_H_
+
+#include <cstdint>
+#include <string_view>
+
+using namespace std;
+
+
+
+// Hash the given text using the 64-bit FNV-1a algorithm. To hash several pieces
+// of text together, pass the hash of the previous ones as the starting value.
+inline uint64_t Hash(string_view text, uint64_t hash = 14695981039346656037ULL)
+{
+	for(char c : text)
+	{
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+
+
+#endif
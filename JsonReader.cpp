@@ -0,0 +1,202 @@
+/* JsonReader.cpp
+Michael Zahniser, 17 Oct 2026
+*/
+
+#include "JsonReader.h"
+
+#include <cstring>
+
+using namespace std;
+
+namespace {
+	// Check if the given character can be part of a number, true, false, or null.
+	bool IsLiteral(char c)
+	{
+		return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' || c == '.' || c == 'E';
+	}
+	
+	// Get the value of a hexadecimal digit, or -1 if it is not one.
+	int HexValue(char c)
+	{
+		if(c >= '0' && c <= '9')
+			return c - '0';
+		if(c >= 'a' && c <= 'f')
+			return c - 'a' + 10;
+		if(c >= 'A' && c <= 'F')
+			return c - 'A' + 10;
+		return -1;
+	}
+}
+
+
+
+// Reset the reader to begin reading a new document.
+void JsonReader::Clear()
+{
+	state = BETWEEN;
+	isObject.clear();
+	expectKey = false;
+	isKey = false;
+	value.clear();
+	escape.clear();
+}
+
+
+
+// Read the next token from the given text, and remove the characters that were
+// read from the front of it.
+JsonReader::Token JsonReader::Next(string_view &text)
+{
+	Token token = NONE;
+	size_t i = 0;
+	while(i < text.size() && token == NONE && state != FAILED)
+	{
+		char c = text[i];
+		if(state == IN_STRING)
+		{
+			if(!escape.empty())
+			{
+				escape += c;
+				++i;
+				if((escape.size() == 2 && c != 'u') || escape.size() == 6)
+					Unescape();
+				continue;
+			}
+			// Copy everything up to the next quote or escape all at once.
+			const char *begin = text.data() + i;
+			const char *quote = static_cast<const char *>(memchr(begin, '"', text.size() - i));
+			size_t length = (quote ? quote - begin : text.size() - i);
+			const char *slash = static_cast<const char *>(memchr(begin, '\\', length));
+			size_t end = i + (slash ? slash - begin : length);
+			value.append(text.data() + i, end - i);
+			i = end;
+			if(i == text.size())
+				break;
+			
+			++i;
+			if(text[i - 1] == '\\')
+				escape = '\\';
+			else
+			{
+				state = BETWEEN;
+				token = (isKey ? KEY : STRING);
+			}
+		}
+		else if(state == IN_LITERAL)
+		{
+			// A literal only ends when some other character is found.
+			if(IsLiteral(c))
+			{
+				value += c;
+				++i;
+			}
+			else
+			{
+				state = BETWEEN;
+				token = LITERAL;
+			}
+		}
+		else
+		{
+			++i;
+			if(c == '{' || c == '[')
+			{
+				isObject.push_back(c == '{');
+				expectKey = (c == '{');
+				token = (c == '{' ? BEGIN_OBJECT : BEGIN_ARRAY);
+			}
+			else if(c == '}' || c == ']')
+			{
+				if(isObject.empty() || isObject.back() != (c == '}'))
+					state = FAILED;
+				else
+				{
+					isObject.pop_back();
+					expectKey = false;
+					token = (c == '}' ? END_OBJECT : END_ARRAY);
+				}
+			}
+			else if(c == ',')
+				expectKey = (!isObject.empty() && isObject.back());
+			else if(c == ':')
+				expectKey = false;
+			else if(c == '"')
+			{
+				state = IN_STRING;
+				isKey = expectKey;
+				expectKey = false;
+				value.clear();
+			}
+			else if(IsLiteral(c))
+			{
+				state = IN_LITERAL;
+				value.assign(1, c);
+			}
+			else if(c != ' ' && c != '\n' && c != '\r' && c != '\t')
+				state = FAILED;
+		}
+	}
+	text.remove_prefix(i);
+	return (state == FAILED ? ERROR : token);
+}
+
+
+
+// Get the text of the last KEY, STRING, or LITERAL token.
+const string &JsonReader::Value() const
+{
+	return value;
+}
+
+
+
+// Get how many objects and arrays the last token is inside of.
+size_t JsonReader::Depth() const
+{
+	return isObject.size();
+}
+
+
+
+// Decode the escape sequence that has been read, and add it to the value.
+void JsonReader::Unescape()
+{
+	char c = escape[1];
+	if(c == 'u')
+	{
+		int code = 0;
+		for(int i = 2; i < 6; ++i)
+		{
+			int digit = HexValue(escape[i]);
+			if(digit < 0)
+				state = FAILED;
+			code = code * 16 + digit;
+		}
+		// Encode the character as UTF-8. Surrogate pairs are not combined, so
+		// characters outside the basic plane are replaced.
+		if(code >= 0xD800 && code < 0xE000)
+			value += '?';
+		else if(code < 0x20)
+			value += ' ';
+		else if(code < 0x80)
+			value += static_cast<char>(code);
+		else if(code < 0x800)
+		{
+			value += static_cast<char>(0xC0 | (code >> 6));
+			value += static_cast<char>(0x80 | (code & 0x3F));
+		}
+		else
+		{
+			value += static_cast<char>(0xE0 | (code >> 12));
+			value += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+			value += static_cast<char>(0x80 | (code & 0x3F));
+		}
+	}
+	// Everything is displayed on a single line, so control characters such as
+	// newlines and tabs just become spaces.
+	else if(c == 'b' || c == 'f' || c == 'n' || c == 'r' || c == 't')
+		value += ' ';
+	else
+		value += c;
+	escape.clear();
+}
@@ -0,0 +1,63 @@
+/* JsonReader.h
+Michael Zahniser, 17 Oct 2026
+
+Class for reading a JSON document one token at a time, as it arrives. The text
+can be split up into pieces at any point, even in the middle of a token, and
+only the token currently being read is ever stored, never the whole document.
+*/
+
+#ifndef JSON_READER_H_
+#define JSON_READER_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+
+
+class JsonReader {
+public:
+	enum Token {NONE, BEGIN_OBJECT, END_OBJECT, BEGIN_ARRAY, END_ARRAY, KEY, STRING, LITERAL, ERROR};
+	
+	
+public:
+	// Reset the reader to begin reading a new document.
+	void Clear();
+	
+	// Read the next token from the given text, and remove the characters that
+	// were read from the front of it. If the text ends before a full token has
+	// been read, this returns NONE and the partial token is kept until more of
+	// the text is given. Once an error is found, this always returns ERROR.
+	Token Next(string_view &text);
+	// Get the text of the last KEY, STRING, or LITERAL token, with any escape
+	// sequences in a string already decoded.
+	const string &Value() const;
+	// Get how many objects and arrays the last token is inside of. Once the
+	// document has begun, it ends when this returns to zero.
+	size_t Depth() const;
+	
+	
+private:
+	// Decode the escape sequence that has been read, and add it to the value.
+	void Unescape();
+	
+	
+private:
+	enum State {BETWEEN, IN_STRING, IN_LITERAL, FAILED};
+	State state = BETWEEN;
+	// Whether each enclosing container is an object (as opposed to an array),
+	// and whether the next string is a key rather than a value.
+	vector<bool> isObject;
+	bool expectKey = false;
+	bool isKey = false;
+	
+	// The value of the current token, and any partial escape sequence in it.
+	string value;
+	string escape;
+};
+
+
+
+#endif
@@ -0,0 +1,73 @@
+/* JsonWriter.cpp
+Michael Zahniser, 17 Oct 2026
+*/
+
+#include "JsonWriter.h"
+
+using namespace std;
+
+
+
+// Begin a new object, discarding the previous one.
+void JsonWriter::Clear()
+{
+	text.assign(1, '{');
+}
+
+
+
+// Add a key and its value to the object.
+void JsonWriter::Add(const char *key, string_view value)
+{
+	static const char HEX[] = "0123456789abcdef";
+	
+	AddKey(key);
+	text += '"';
+	for(char c : value)
+	{
+		if(c == '"' || c == '\\')
+		{
+			text += '\\';
+			text += c;
+		}
+		else if(static_cast<unsigned char>(c) < 0x20)
+		{
+			text += "\\u00";
+			text += HEX[c >> 4];
+			text += HEX[c & 15];
+		}
+		else
+			text += c;
+	}
+	text += '"';
+}
+
+
+
+void JsonWriter::Add(const char *key, int value)
+{
+	AddKey(key);
+	text += to_string(value);
+}
+
+
+
+// Get the object as a line of text, including the terminating newline.
+const string &JsonWriter::Line()
+{
+	if(text.back() != '\n')
+		text += "}\n";
+	return text;
+}
+
+
+
+// Add the given key, and the separator before it if it is not the first.
+void JsonWriter::AddKey(const char *key)
+{
+	if(text.size() > 1)
+		text += ',';
+	text += '"';
+	text += key;
+	text += "\":";
+}
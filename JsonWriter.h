@@ -0,0 +1,43 @@
+/* JsonWriter.h
+Michael Zahniser, 17 Oct 2026
+
+Class for building a JSON object one key at a time, as a single line of text,
+for tools that read output in the JSON Lines format. The same string is reused
+for each object, so writing many of them does not allocate any memory.
+*/
+
+#ifndef JSON_WRITER_H_
+#define JSON_WRITER_H_
+
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+
+
+class JsonWriter {
+public:
+	// Begin a new object, discarding the previous one.
+	void Clear();
+	// Add a key and its value to the object.
+	void Add(const char *key, string_view value);
+	void Add(const char *key, int value);
+	
+	// Get the object as a line of text, including the terminating newline. No
+	// more keys can be added after this.
+	const string &Line();
+	
+	
+private:
+	// Add the given key, and the separator before it if it is not the first.
+	void AddKey(const char *key);
+	
+	
+private:
+	string text = "{";
+};
+
+
+
+#endif
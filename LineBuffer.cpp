@@ -0,0 +1,149 @@
+/* LineBuffer.cpp
+Michael Zahniser, 17 Oct 2026
+*/
+
+#include "LineBuffer.h"
+
+#include <cstring>
+
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+	// Pipes on Linux hold 64 KiB by default, so read up to that much at once.
+	const size_t READ_SIZE = 65536;
+}
+
+
+
+// Read whatever text is available from the given file descriptor, with a
+// single read() call.
+ssize_t LineBuffer::ReadFrom(int fd)
+{
+	Reserve();
+	ssize_t length = read(fd, data.data() + end, data.size() - end);
+	if(length > 0)
+		end += length;
+	return length;
+}
+
+
+
+// If the buffer ends with a partial line, terminate it so that it will be
+// returned by NextLine(). This is used once the input has ended.
+void LineBuffer::Finish()
+{
+	if(begin == end || data[end - 1] == '\n')
+		return;
+	
+	if(end == data.size())
+		Reserve();
+	data[end++] = '\n';
+}
+
+
+
+// Discard all buffered text.
+void LineBuffer::Clear()
+{
+	begin = 0;
+	end = 0;
+	scanned = 0;
+}
+
+
+
+// Get the next full line of text, not including the terminating '\n'.
+bool LineBuffer::NextLine(string_view &line)
+{
+	if(!HasLine())
+		return false;
+	
+	// HasLine() leaves the scan position pointing at the newline.
+	line = string_view(data.data() + begin, scanned - begin);
+	begin = scanned + 1;
+	scanned = begin;
+	return true;
+}
+
+
+
+// Get all the text that has not been returned yet, even a partial line.
+string_view LineBuffer::Peek() const
+{
+	return string_view(data.data() + begin, end - begin);
+}
+
+
+
+// Discard the given number of characters from the start of that text.
+void LineBuffer::Consume(size_t count)
+{
+	begin += min(count, end - begin);
+}
+
+
+
+// Check if a full line of text is available.
+bool LineBuffer::HasLine() const
+{
+	// Only search the text that has not been searched already.
+	scanned = max(scanned, begin);
+	const void *it = memchr(data.data() + scanned, '\n', end - scanned);
+	if(it)
+	{
+		scanned = static_cast<const char *>(it) - data.data();
+		return true;
+	}
+	scanned = end;
+	return false;
+}
+
+
+
+// Check if there is any text in the buffer, even a partial line.
+bool LineBuffer::IsEmpty() const
+{
+	return begin == end;
+}
+
+
+
+// Get the number of bytes of text that have not been returned yet.
+size_t LineBuffer::Size() const
+{
+	return end - begin;
+}
+
+
+
+// Get the number of bytes of memory allocated for the buffer.
+size_t LineBuffer::Capacity() const
+{
+	return data.capacity();
+}
+
+
+
+// Make sure there is room for at least one full-sized read at the end of the
+// buffer, moving any unread text to the start of it if necessary.
+void LineBuffer::Reserve()
+{
+	// If everything has been read, start over from the beginning.
+	if(begin == end)
+		Clear();
+	else if(data.size() - end < READ_SIZE && begin)
+	{
+		// Only the text that has not been returned yet is moved, which is
+		// normally no more than a partial line.
+		memmove(data.data(), data.data() + begin, end - begin);
+		end -= begin;
+		scanned -= min(scanned, begin);
+		begin = 0;
+	}
+	
+	// If a single line is longer than the buffer, the buffer must grow.
+	if(data.size() - end < READ_SIZE)
+		data.resize(max(2 * data.size(), end + READ_SIZE));
+}
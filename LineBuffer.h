@@ -0,0 +1,73 @@
+/* LineBuffer.h
+Michael Zahniser, 17 Oct 2026
+
+Class for buffering text read from a pipe and handing it out one line at a
+time. Lines are returned as views into the buffer rather than as copies, and
+the buffer keeps track of how far it has already searched for a newline, so
+each byte is only scanned once no matter how the text arrives.
+*/
+
+#ifndef LINE_BUFFER_H_
+#define LINE_BUFFER_H_
+
+#include <string_view>
+#include <vector>
+
+#include <sys/types.h>
+
+using namespace std;
+
+
+
+class LineBuffer {
+public:
+	// Read whatever text is available from the given file descriptor, with a
+	// single read() call. This returns the result of that call, i.e. the number
+	// of bytes read, or 0 at the end of the input, or -1 if an error occurred.
+	// Any lines returned by NextLine() before this call are invalidated.
+	ssize_t ReadFrom(int fd);
+	// If the buffer ends with a partial line, terminate it so that it will be
+	// returned by NextLine(). This is used once the input has ended.
+	void Finish();
+	// Discard all buffered text.
+	void Clear();
+	
+	// Get the next full line of text, not including the terminating '\n'. If
+	// there is no full line available, this returns false. The returned view
+	// remains valid until the next call to ReadFrom(), Finish(), or Clear().
+	bool NextLine(string_view &line);
+	// Get all the text that has not been returned yet, even a partial line, so
+	// that it can be handled some other way than line by line. The view remains
+	// valid until the next call to ReadFrom(), Finish(), or Clear().
+	string_view Peek() const;
+	// Discard the given number of characters from the start of that text.
+	void Consume(size_t count);
+	// Check if a full line of text is available.
+	bool HasLine() const;
+	// Check if there is any text in the buffer, even a partial line.
+	bool IsEmpty() const;
+	// Get the number of bytes of text that have not been returned yet, and the
+	// number of bytes of memory allocated for the buffer.
+	size_t Size() const;
+	size_t Capacity() const;
+	
+	
+private:
+	// Make sure there is room for at least one full-sized read at the end of
+	// the buffer, moving any unread text to the start of it if necessary.
+	void Reserve();
+	
+	
+private:
+	vector<char> data;
+	// The start of the next line that has not been returned yet.
+	size_t begin = 0;
+	// The end of the text that has been read into the buffer.
+	size_t end = 0;
+	// Everything between begin and this position is known not to be a newline.
+	mutable size_t scanned = 0;
+};
+
+
+
+#endif
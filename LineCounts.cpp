@@ -0,0 +1,111 @@
+/* LineCounts.cpp
+Michael Zahniser, 17 Oct 2026
+*/
+
+#include "LineCounts.h"
+
+using namespace std;
+
+namespace {
+	// Get the value of the lowest set bit in the given index.
+	int LowBit(int i)
+	{
+		return i & -i;
+	}
+}
+
+
+
+// Remove all items.
+void LineCounts::Clear()
+{
+	counts.clear();
+	tree.resize(1);
+}
+
+
+
+// Add an item to the end of the list.
+void LineCounts::Add(int count)
+{
+	// The new tree node covers this item and the items before it that are not
+	// covered by the node LowBit() below it.
+	int i = counts.size() + 1;
+	counts.push_back(count);
+	tree.push_back(count + Sum(i - 1) - Sum(i - LowBit(i)));
+}
+
+
+
+// Change the line count of the given item.
+void LineCounts::Set(int index, int count)
+{
+	int delta = count - counts[index];
+	counts[index] = count;
+	if(!delta)
+		return;
+	
+	int size = counts.size();
+	for(int i = index + 1; i <= size; i += LowBit(i))
+		tree[i] += delta;
+}
+
+
+
+// Get the number of items.
+int LineCounts::Size() const
+{
+	return counts.size();
+}
+
+
+
+// Get the line count of the given item.
+int LineCounts::Count(int index) const
+{
+	return counts[index];
+}
+
+
+
+// Get the total line count of all items before the given index.
+int LineCounts::Sum(int index) const
+{
+	int sum = 0;
+	for(int i = index; i > 0; i -= LowBit(i))
+		sum += tree[i];
+	return sum;
+}
+
+
+
+// Get the total line count of all the items.
+int LineCounts::Total() const
+{
+	return Sum(counts.size());
+}
+
+
+
+// Get the index of the item that the given line is part of.
+int LineCounts::Find(int line) const
+{
+	if(line < 0)
+		return 0;
+	
+	// Descend the tree to find the largest number of items whose total line
+	// count is no more than the given line. The next item contains that line.
+	int size = counts.size();
+	int step = 1;
+	while(step * 2 <= size)
+		step *= 2;
+	
+	int index = 0;
+	for( ; step; step /= 2)
+		if(index + step <= size && tree[index + step] <= line)
+		{
+			index += step;
+			line -= tree[index];
+		}
+	return index;
+}
@@ -0,0 +1,53 @@
+/* LineCounts.h
+Michael Zahniser, 17 Oct 2026
+
+Class storing how many lines of the screen each item in a list takes up, in a
+Fenwick tree so that both finding the line an item starts on and finding which
+item is on a given line take logarithmic time. Items can be appended and their
+line counts can be changed in logarithmic time as well.
+*/
+
+#ifndef LINE_COUNTS_H_
+#define LINE_COUNTS_H_
+
+#include <vector>
+
+using namespace std;
+
+
+
+class LineCounts {
+public:
+	// Remove all items.
+	void Clear();
+	// Add an item to the end of the list.
+	void Add(int count);
+	// Change the line count of the given item.
+	void Set(int index, int count);
+	
+	// Get the number of items.
+	int Size() const;
+	// Get the line count of the given item.
+	int Count(int index) const;
+	// Get the total line count of all items before the given index. This is the
+	// line that item starts on, if the first item starts on line 0.
+	int Sum(int index) const;
+	// Get the total line count of all the items.
+	int Total() const;
+	// Get the index of the item that the given line is part of. If the line is
+	// past the end of the last item, this returns Size(). Items with a line
+	// count of zero are never returned, except in that case.
+	int Find(int line) const;
+	
+	
+private:
+	// The line count of each item.
+	vector<int> counts;
+	// The Fenwick tree. Element i (counting from 1) holds the sum of the line
+	// counts of the items in the range (i - lowbit(i), i].
+	vector<int> tree = vector<int>(1);
+};
+
+
+
+#endif
@@ -10,61 +10,49 @@ using namespace std;
 
 
 
-// Construct a message.
-Message::Message(Type type, const string &header, const string &text)
+// Get the type of this message.
+Message::Type Message::GetType() const
 {
-	// Copy the text.
-	message.push_back("██ " + header);
-	message.push_back(text);
-	
-	// Set the color.
-	color = (type == ERROR ? COLOR_RED : type == WARNING ? COLOR_YELLOW : COLOR_CYAN);
-	
-	// Parse the text to figure out what file this error message comes from.
-	// Some link errors may not list a file; they will start with '('.
-	if(!text.empty() && text[0] != '(')
-	{
-		size_t pos = text.find(':');
-		file = text.substr(0, pos);
-		if(type != LINK)
-		{
-			line = atol(text.data() + pos + 1);
-			pos = text.find(':', pos + 1);
-			if(pos != string::npos)
-				column = atol(text.data() + pos + 1);
-		}
-	}
+	return type;
 }
 
 
 
-// Add a line of text to the message.
-void Message::AddText(const string &text)
+// Get the color to use to display this message.
+int Message::Color() const
 {
-	message.push_back(text);
+	return (type == ERROR ? COLOR_RED : type == WARNING ? COLOR_YELLOW : COLOR_CYAN);
 }
 
 
 
-// Get all the lines of text in the message.
-const vector<string> &Message::Text() const
+// Get the number of lines of text in the message, including the header and (if
+// it occurred more than once) the line saying where else it occurred.
+int Message::LineCount() const
 {
-	return message;
+	return topLineCount + (lineCount > topLineCount) + (occurrences > 1);
 }
 
 
 
-// Get the color to use to display this message.
-int Message::Color() const
+int Message::ExpandedLineCount() const
+{
+	return lineCount + (occurrences > 1);
+}
+
+
+
+// Get the number of lines that are only shown when the message is expanded.
+int Message::HiddenLineCount() const
 {
-	return color;
+	return lineCount - topLineCount;
 }
 
 
 
-// If this message is from a particular file, get the path to the file. (If
-// there is no specific file, this returns an empty string.)
-const string &Message::File() const
+// If this message is from a particular file, get the ID of the path to the file.
+// (If there is no specific file, this returns -1.)
+int Message::File() const
 {
 	return file;
 }
@@ -86,3 +74,28 @@ int Message::Column() const
 {
 	return column;
 }
+
+
+
+// Get how many times this exact message occurred in the build.
+int Message::Occurrences() const
+{
+	return occurrences;
+}
+
+
+
+// Get how this message compares to the previous build.
+Message::Status Message::GetStatus() const
+{
+	return status;
+}
+
+
+
+// Get a hash of the message's file, position, and text, which identifies the
+// same message in different builds.
+uint64_t Message::Key() const
+{
+	return key;
+}
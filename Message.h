@@ -1,14 +1,15 @@
 /* Message.h
 Michael Zahniser, 19 Dec 2018
 
-Class representing a single error or warning message from the compiler.
+Class representing a single error or warning message from the compiler. The
+text of the message is stored in the MessageList that the message belongs to;
+the message itself only holds the indices needed to look it up.
 */
 
 #ifndef MESSAGE_H_
 #define MESSAGE_H_
 
-#include <string>
-#include <vector>
+#include <cstdint>
 
 using namespace std;
 
@@ -18,36 +19,66 @@ class Message {
 public:
 	// Message types. Each one corresponds to a different color.
 	enum Type {WARNING, ERROR, LINK, NONE};
+	// How a message compares to the messages from the last build that finished,
+	// if there was one: it is new, it was there before, or it is one of the
+	// previous messages that is gone now.
+	enum Status {UNKNOWN, NEW, PERSISTING, FIXED};
 	
 	
 public:
-	// Construct a message.
-	Message(Type type, const string &header, const string &text);
-	
-	// Add a line of text to the message.
-	void AddText(const string &text);
-	
-	// Get all the lines of text in the message.
-	const vector<string> &Text() const;
+	// Get the type of this message.
+	Type GetType() const;
 	// Get the color to use to display this message.
 	int Color() const;
+	// Get the number of lines of text in the message, including the header and
+	// (if it occurred more than once) the line saying where else it occurred.
+	// Unless the message is expanded, only its lines at depth 0 are shown, and
+	// a line saying how many others there are takes the place of the rest.
+	int LineCount() const;
+	int ExpandedLineCount() const;
+	// Get the number of lines that are only shown when the message is expanded.
+	int HiddenLineCount() const;
 	
 	// Get the file and the position within that file that this message is from.
-	const string &File() const;
+	// The file is the ID of a path in the MessageList's table of paths.
+	int File() const;
 	int Line() const;
 	int Column() const;
 	
+	// Get how many times this exact message occurred in the build.
+	int Occurrences() const;
+	// Get how this message compares to the previous build.
+	Status GetStatus() const;
+	// Get a hash of the message's file, position, and text, which identifies
+	// the same message in different builds.
+	uint64_t Key() const;
+	
 	
 private:
-	// The text of the message, broken into lines.
-	vector<string> message;
-	// The color to use for displaying this message.
-	int color = 0;
+	friend class MessageList;
+	
+	uint64_t key = 0;
+	
+	// The lines of text of the message, as indices into the list's line table.
+	// The lines at depth 0 come first, ending with lastTopLine.
+	uint32_t firstLine = 0;
+	uint32_t lastLine = 0;
+	uint32_t lineCount = 0;
+	uint32_t lastTopLine = 0;
+	uint32_t topLineCount = 0;
+	
+	// How many times this message occurred, and the ID of the path of the first
+	// translation unit it occurred in.
+	uint32_t occurrences = 1;
+	int32_t unit = -1;
 	
 	// The file associated with this message (if any) and the position in it.
-	string file;
-	int line = -1;
-	int column = -1;
+	int32_t file = -1;
+	int32_t line = -1;
+	int32_t column = -1;
+	
+	Type type = NONE;
+	Status status = UNKNOWN;
 };
 
 
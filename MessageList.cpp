@@ -0,0 +1,546 @@
+/* MessageList.cpp
+Michael Zahniser, 17 Oct 2026
+*/
+
+#include "MessageList.h"
+
+#include "Hash.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+	// The header is drawn with a block in front of it, to make it easier to see
+	// where each message begins.
+	const string_view HEADER_PREFIX = "██ ";
+	// The first bytes of a saved cache. The version number is increased
+	// whenever the format changes, so old caches are just ignored.
+	const string_view CACHE_MAGIC = "gorp cache 3\n";
+	// The limits on the length and depth of a line, which are packed together.
+	const size_t MAX_LENGTH = (1 << 24) - 1;
+	const int MAX_DEPTH = (1 << 8) - 1;
+	
+	// Append a number to the given data, in the machine's own byte order. The
+	// cache is only meant to be read on the machine that wrote it.
+	template <class Type>
+	void Write(string &data, Type value)
+	{
+		data.append(reinterpret_cast<const char *>(&value), sizeof(value));
+	}
+	
+	// Append some text to the given data, preceded by its length.
+	void Write(string &data, string_view text)
+	{
+		Write<uint32_t>(data, text.size());
+		data.append(text);
+	}
+	
+	// Class for reading back what the functions above wrote. Once any read
+	// fails, all the reads after it do too.
+	class Reader {
+	public:
+		explicit Reader(string_view data)
+			: data(data)
+		{
+		}
+		
+		template <class Type>
+		bool Read(Type &value)
+		{
+			isValid &= (data.size() >= sizeof(value));
+			if(isValid)
+			{
+				memcpy(&value, data.data(), sizeof(value));
+				data.remove_prefix(sizeof(value));
+			}
+			return isValid;
+		}
+		
+		bool Read(string_view &text)
+		{
+			uint32_t size = 0;
+			isValid &= (Read(size) && data.size() >= size);
+			if(isValid)
+			{
+				text = data.substr(0, size);
+				data.remove_prefix(size);
+			}
+			return isValid;
+		}
+		
+		bool IsValid() const
+		{
+			return isValid;
+		}
+	
+	private:
+		string_view data;
+		bool isValid = true;
+	};
+}
+
+
+
+MessageList::Lines::Iterator::Iterator(const vector<TextLine> &lines, uint32_t index, uint32_t remaining)
+	: lines(lines), index(index), remaining(remaining)
+{
+}
+
+
+
+string_view MessageList::Lines::Iterator::operator*() const
+{
+	const TextLine &line = lines[index];
+	return string_view(line.text, line.length);
+}
+
+
+
+// Get the depth of the current line.
+int MessageList::Lines::Iterator::Depth() const
+{
+	return lines[index].depth;
+}
+
+
+
+MessageList::Lines::Iterator &MessageList::Lines::Iterator::operator++()
+{
+	index = lines[index].next;
+	--remaining;
+	return *this;
+}
+
+
+
+bool MessageList::Lines::Iterator::operator!=(const Iterator &other) const
+{
+	return remaining != other.remaining;
+}
+
+
+
+MessageList::Lines::Lines(const vector<TextLine> &lines, const Message &message)
+	: lines(lines), message(message)
+{
+}
+
+
+
+MessageList::Lines::Iterator MessageList::Lines::begin() const
+{
+	return Iterator(lines, message.firstLine, message.lineCount);
+}
+
+
+
+MessageList::Lines::Iterator MessageList::Lines::end() const
+{
+	return Iterator(lines, message.lastLine, 0);
+}
+
+
+
+// Remove all messages, freeing all the memory used for their text.
+void MessageList::Clear()
+{
+	messages.clear();
+	lines.clear();
+	text.Clear();
+	paths.Clear();
+	headers.Clear();
+	units.clear();
+}
+
+
+
+// Add a message for the given diagnostic, with the given header line, and
+// return its index. The diagnostic's text is the first line of the message.
+// The unit is the path of the translation unit that the message came from.
+int MessageList::Add(const Diagnostic &diagnostic, string_view header, string_view unit)
+{
+	uint64_t key = Key(diagnostic);
+	messages.emplace_back();
+	Message &message = messages.back();
+	message.type = diagnostic.type;
+	if(!diagnostic.file.empty())
+		message.file = paths.Intern(diagnostic.file);
+	message.line = diagnostic.line;
+	message.column = diagnostic.column;
+	message.key = key;
+	if(!unit.empty())
+		message.unit = paths.Intern(unit);
+	
+	// Headers are interned, because all the messages from one function share
+	// the same one.
+	this->header = HEADER_PREFIX;
+	this->header += header;
+	string_view copy = headers.Get(headers.Intern(this->header));
+	message.firstLine = lines.size();
+	message.lastLine = lines.size();
+	message.lineCount = 1;
+	message.lastTopLine = lines.size();
+	message.topLineCount = 1;
+	lines.push_back(TextLine{copy.data(), static_cast<uint32_t>(copy.size()), 0, 0});
+	AddText(messages.size() - 1, diagnostic.text);
+	
+	return messages.size() - 1;
+}
+
+
+
+// Add a line of text to the message with the given index, at the given depth
+// in its tree of lines.
+void MessageList::AddText(int index, string_view text, int depth)
+{
+	Message &message = messages[index];
+	string_view copy = this->text.Copy(text.substr(0, MAX_LENGTH));
+	depth = min(depth, MAX_DEPTH);
+	uint32_t line = lines.size();
+	lines.push_back(TextLine{copy.data(), static_cast<uint32_t>(copy.size()), static_cast<uint32_t>(depth), 0});
+	
+	// Link the new line into the message's chain of lines, either at the end
+	// or, if it is at depth 0, after the last line at depth 0.
+	uint32_t previous = (depth ? message.lastLine : message.lastTopLine);
+	lines[line].next = lines[previous].next;
+	lines[previous].next = line;
+	if(previous == message.lastLine)
+		message.lastLine = line;
+	if(!depth)
+	{
+		message.lastTopLine = line;
+		++message.topLineCount;
+	}
+	++message.lineCount;
+}
+
+
+
+// Copy the message with the given index from another list, and return its index
+// in this one.
+int MessageList::Copy(const MessageList &other, int index)
+{
+	const Message &message = other[index];
+	Diagnostic diagnostic;
+	diagnostic.type = message.type;
+	diagnostic.file = other.Path(message.file);
+	diagnostic.line = message.line;
+	diagnostic.column = message.column;
+	
+	// The first line is the header, and the second is the diagnostic itself.
+	int copy = -1;
+	int line = 0;
+	Lines range = other.Text(index);
+	for(Lines::Iterator it = range.begin(); it != range.end(); ++it)
+	{
+		if(line == 1)
+		{
+			diagnostic.text = *it;
+			copy = Add(diagnostic, other.Header(index), other.Unit(index, 0));
+		}
+		else if(line > 1)
+			AddText(copy, *it, it.Depth());
+		++line;
+	}
+	for(int i = 1; i < other.UnitCount(index); ++i)
+		AddOccurrence(copy, other.Unit(index, i));
+	messages[copy].occurrences = message.occurrences;
+	messages[copy].status = message.status;
+	return copy;
+}
+
+
+
+// Set how the message with the given index compares to the previous build.
+void MessageList::SetStatus(int index, Message::Status status)
+{
+	messages[index].status = status;
+}
+
+
+
+// Count another occurrence of the message with the given index, in the given
+// translation unit.
+void MessageList::AddOccurrence(int index, string_view unit)
+{
+	Message &message = messages[index];
+	++message.occurrences;
+	if(unit.empty())
+		return;
+	
+	int id = paths.Intern(unit);
+	if(message.unit < 0)
+		message.unit = id;
+	else if(id != message.unit)
+	{
+		// Most messages only ever occur in one unit, so the list of the others
+		// is only created when it is needed.
+		vector<int> &others = units[index];
+		if(find(others.begin(), others.end(), id) == others.end())
+			others.push_back(id);
+	}
+}
+
+
+
+// Get the key that a message for the given diagnostic would have.
+uint64_t MessageList::Key(const Diagnostic &diagnostic)
+{
+	// Resolve "." and ".." in the path. This is done without checking the file
+	// system, so it is not affected by symbolic links, but two messages must
+	// also have the same position and text to have the same key.
+	string_view file = diagnostic.file;
+	components.clear();
+	for(size_t pos = 0; pos < file.size(); )
+	{
+		size_t end = min(file.find('/', pos), file.size());
+		string_view component = file.substr(pos, end - pos);
+		if(component == ".." && !components.empty() && components.back() != "..")
+			components.pop_back();
+		else if(!component.empty() && component != ".")
+			components.push_back(component);
+		pos = end + 1;
+	}
+	uint64_t hash = Hash(file.substr(0, !file.empty() && file.front() == '/'));
+	for(string_view component : components)
+		hash = Hash("/", Hash(component, hash));
+	
+	// The text starts with the path as it was given, so that is left out.
+	char position[2 * sizeof(int32_t)];
+	int32_t line = diagnostic.line;
+	int32_t column = diagnostic.column;
+	memcpy(position, &line, sizeof(int32_t));
+	memcpy(position + sizeof(int32_t), &column, sizeof(int32_t));
+	string_view text = diagnostic.text;
+	if(!file.empty() && !text.compare(0, file.size(), file))
+		text.remove_prefix(file.size());
+	return Hash(text, Hash(string_view(position, sizeof(position)), hash));
+}
+
+
+
+// Save all the messages, except for fixed ones, to the given file.
+bool MessageList::Save(const string &path) const
+{
+	string data(CACHE_MAGIC);
+	// The paths are saved in order, so loading them gives them the same IDs.
+	Write<uint32_t>(data, paths.Size());
+	for(int i = 0; i < paths.Size(); ++i)
+		Write(data, paths.Get(i));
+	
+	uint32_t count = 0;
+	for(const Message &message : messages)
+		count += (message.status != Message::FIXED);
+	Write(data, count);
+	for(int i = 0; i < Size(); ++i)
+	{
+		const Message &message = messages[i];
+		if(message.status == Message::FIXED)
+			continue;
+		
+		Write<int32_t>(data, message.file);
+		Write<int32_t>(data, message.line);
+		Write<int32_t>(data, message.column);
+		Write<uint8_t>(data, message.type);
+		Write<uint32_t>(data, message.lineCount);
+		Write<uint32_t>(data, message.occurrences);
+		Write<uint32_t>(data, UnitCount(i));
+		for(int unit = 0; unit < UnitCount(i); ++unit)
+			Write<int32_t>(data, (unit ? units.at(i)[unit - 1] : message.unit));
+		// The header and the diagnostic are always at depth 0. Every line after
+		// them is saved with its depth.
+		int line = 0;
+		Lines range = Text(i);
+		for(Lines::Iterator it = range.begin(); it != range.end(); ++it)
+		{
+			if(line++ > 1)
+				Write<uint8_t>(data, it.Depth());
+			Write(data, line == 1 ? Header(i) : *it);
+		}
+	}
+	
+	// Write the cache to a temporary file first, so that if writing it fails,
+	// the previous cache is left as it was.
+	string temporary = path + ".tmp";
+	FILE *file = fopen(temporary.c_str(), "wb");
+	if(!file)
+		return false;
+	bool isWritten = (fwrite(data.data(), 1, data.size(), file) == data.size());
+	isWritten &= !fclose(file);
+	if(isWritten && !rename(temporary.c_str(), path.c_str()))
+		return true;
+	remove(temporary.c_str());
+	return false;
+}
+
+
+
+// Replace the messages with the ones saved in the given file.
+bool MessageList::Load(const string &path)
+{
+	Clear();
+	
+	// Read the whole file at once.
+	FILE *file = fopen(path.c_str(), "rb");
+	if(!file)
+		return false;
+	string data;
+	char buffer[65536];
+	for(size_t size; (size = fread(buffer, 1, sizeof(buffer), file)); )
+		data.append(buffer, size);
+	fclose(file);
+	if(data.compare(0, CACHE_MAGIC.size(), CACHE_MAGIC))
+		return false;
+	
+	Reader reader(string_view(data).substr(CACHE_MAGIC.size()));
+	uint32_t pathCount = 0;
+	reader.Read(pathCount);
+	string_view text;
+	for(uint32_t i = 0; i < pathCount && reader.Read(text); ++i)
+		paths.Intern(text);
+	
+	uint32_t count = 0;
+	reader.Read(count);
+	vector<int32_t> unitIDs;
+	for(uint32_t i = 0; i < count; ++i)
+	{
+		int32_t fileID = -1;
+		uint8_t type = Message::NONE;
+		uint32_t lineCount = 0;
+		uint32_t occurrences = 0;
+		uint32_t unitCount = 0;
+		bool hasBadUnit = false;
+		Diagnostic diagnostic;
+		string_view header;
+		reader.Read(fileID);
+		reader.Read(diagnostic.line);
+		reader.Read(diagnostic.column);
+		reader.Read(type);
+		reader.Read(lineCount);
+		reader.Read(occurrences);
+		reader.Read(unitCount);
+		unitIDs.clear();
+		for(uint32_t unit = 0; unit < unitCount && reader.IsValid(); ++unit)
+		{
+			unitIDs.push_back(-1);
+			reader.Read(unitIDs.back());
+			hasBadUnit |= (unitIDs.back() < 0 || unitIDs.back() >= paths.Size());
+		}
+		reader.Read(header);
+		if(!reader.Read(diagnostic.text) || fileID >= paths.Size() || type > Message::NONE || lineCount < 2
+				|| !occurrences || hasBadUnit)
+		{
+			Clear();
+			return false;
+		}
+		diagnostic.type = static_cast<Message::Type>(type);
+		diagnostic.file = Path(fileID);
+		int index = Add(diagnostic, header, unitIDs.empty() ? string_view() : Path(unitIDs.front()));
+		uint8_t depth = 0;
+		for(uint32_t line = 2; line < lineCount && reader.Read(depth) && reader.Read(text); ++line)
+			AddText(index, text, depth);
+		for(size_t unit = 1; unit < unitIDs.size(); ++unit)
+			AddOccurrence(index, Path(unitIDs[unit]));
+		messages[index].occurrences = occurrences;
+	}
+	// If the file was cut off, don't use any of it.
+	if(!reader.IsValid())
+		Clear();
+	return reader.IsValid();
+}
+
+
+
+// Get the number of messages.
+int MessageList::Size() const
+{
+	return messages.size();
+}
+
+
+
+bool MessageList::IsEmpty() const
+{
+	return messages.empty();
+}
+
+
+
+// Get the message with the given index.
+const Message &MessageList::operator[](int index) const
+{
+	return messages[index];
+}
+
+
+
+// Get all the lines of text in the message with the given index.
+MessageList::Lines MessageList::Text(int index) const
+{
+	return Lines(lines, messages[index]);
+}
+
+
+
+// Get the header line of the message with the given index, without the block
+// that is drawn in front of it.
+string_view MessageList::Header(int index) const
+{
+	const TextLine &line = lines[messages[index].firstLine];
+	return string_view(line.text, line.length).substr(HEADER_PREFIX.size());
+}
+
+
+
+// Get the line after the header of the message with the given index.
+string_view MessageList::FirstLine(int index) const
+{
+	const TextLine &line = lines[lines[messages[index].firstLine].next];
+	return string_view(line.text, line.length);
+}
+
+
+
+// Get the path of the file with the given ID (or an empty string if the ID is
+// -1, meaning no file).
+string_view MessageList::Path(int file) const
+{
+	return (file < 0 ? string_view() : paths.Get(file));
+}
+
+
+
+// Get the number of distinct translation units the message with the given index
+// occurred in.
+int MessageList::UnitCount(int index) const
+{
+	if(messages[index].unit < 0)
+		return 0;
+	auto it = units.find(index);
+	return 1 + (it == units.end() ? 0 : it->second.size());
+}
+
+
+
+// Get the path of one of the translation units the message with the given index
+// occurred in.
+string_view MessageList::Unit(int index, int i) const
+{
+	return Path(i ? units.at(index)[i - 1] : messages[index].unit);
+}
+
+
+
+// Get an estimate of the number of bytes of memory used by the messages.
+size_t MessageList::Capacity() const
+{
+	size_t unitCapacity = units.bucket_count() * sizeof(void *);
+	for(const auto &it : units)
+		unitCapacity += sizeof(it) + it.second.capacity() * sizeof(int);
+	return messages.capacity() * sizeof(Message) + lines.capacity() * sizeof(TextLine)
+		+ text.Capacity() + paths.Capacity() + headers.Capacity() + header.capacity()
+		+ unitCapacity + components.capacity() * sizeof(string_view);
+}
@@ -0,0 +1,157 @@
+/* MessageList.h
+Michael Zahniser, 17 Oct 2026
+
+Class holding all the messages from one build. The text of the messages is
+copied into an arena, so that it can all be freed at once when the next build
+starts, and file paths and headers (which are repeated in many messages) are
+interned so that each one is only stored once. A message that is repeated (e.g.
+a warning in a header that many source files include) can be listed just once,
+with a count of how many times it occurred and in which translation units.
+
+Each line of a message also has a depth, so that the notes and backtraces that
+explain a message can be kept in full but hidden until they are wanted. Lines
+are linked together rather than stored in order, so that a line at depth 0 can
+be inserted after the message's other lines at depth 0, which always come first.
+*/
+
+#ifndef MESSAGE_LIST_H_
+#define MESSAGE_LIST_H_
+
+#include "Arena.h"
+#include "Diagnostic.h"
+#include "Message.h"
+#include "StringTable.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+
+
+class MessageList {
+private:
+	// A line of text in a message, its depth, and the index of the next line in
+	// the same message (if there is one). The length and the depth share one
+	// 32-bit word, which limits each line to 16 MB.
+	class TextLine {
+	public:
+		const char *text;
+		uint32_t length : 24;
+		uint32_t depth : 8;
+		uint32_t next;
+	};
+	
+	
+public:
+	// Range of the lines of text in one message, for use in range-based loops.
+	class Lines {
+	public:
+		class Iterator {
+		public:
+			Iterator(const vector<TextLine> &lines, uint32_t index, uint32_t remaining);
+			
+			string_view operator*() const;
+			// Get the depth of the current line.
+			int Depth() const;
+			Iterator &operator++();
+			bool operator!=(const Iterator &other) const;
+			
+		private:
+			const vector<TextLine> &lines;
+			uint32_t index;
+			uint32_t remaining;
+		};
+		
+	public:
+		Lines(const vector<TextLine> &lines, const Message &message);
+		
+		Iterator begin() const;
+		Iterator end() const;
+		
+	private:
+		const vector<TextLine> &lines;
+		const Message &message;
+	};
+	
+	
+public:
+	// Remove all messages, freeing all the memory used for their text.
+	void Clear();
+	// Add a message for the given diagnostic, with the given header line, and
+	// return its index. The diagnostic's text is the first line of the message.
+	// The unit is the path of the translation unit (the source file that was
+	// being compiled) that the message came from, if that is known.
+	int Add(const Diagnostic &diagnostic, string_view header, string_view unit = string_view());
+	// Add a line of text to the message with the given index, at the given
+	// depth in its tree of lines. Lines at depth 0 are always shown; the others
+	// (notes, backtraces, and their source excerpts) are shown when the message
+	// is expanded.
+	void AddText(int index, string_view text, int depth = 0);
+	// Copy the message with the given index from another list, and return its
+	// index in this one.
+	int Copy(const MessageList &other, int index);
+	// Set how the message with the given index compares to the previous build.
+	void SetStatus(int index, Message::Status status);
+	// Count another occurrence of the message with the given index, in the
+	// given translation unit.
+	void AddOccurrence(int index, string_view unit);
+	// Get the key that a message for the given diagnostic would have. The path
+	// is normalized first, so that the same file reached through different
+	// relative paths (e.g. "src/../include/a.h") gives the same key.
+	uint64_t Key(const Diagnostic &diagnostic);
+	
+	// Save all the messages, except for fixed ones, to the given file, or
+	// replace the messages with the ones saved in it. These return false if the
+	// file cannot be written or read, or is not a valid cache.
+	bool Save(const string &path) const;
+	bool Load(const string &path);
+	
+	// Get the number of messages.
+	int Size() const;
+	bool IsEmpty() const;
+	// Get the message with the given index.
+	const Message &operator[](int index) const;
+	// Get all the lines of text in the message with the given index.
+	Lines Text(int index) const;
+	// Get the header line of the message with the given index, without the
+	// block that is drawn in front of it.
+	string_view Header(int index) const;
+	// Get the line after the header of the message with the given index, which
+	// is the diagnostic that the message was created from.
+	string_view FirstLine(int index) const;
+	// Get the path of the file with the given ID (or an empty string if the ID
+	// is -1, meaning no file).
+	string_view Path(int file) const;
+	// Get the number of distinct translation units the message with the given
+	// index occurred in, and the path of each of them.
+	int UnitCount(int index) const;
+	string_view Unit(int index, int i) const;
+	
+	// Get an estimate of the number of bytes of memory used by the messages.
+	size_t Capacity() const;
+	
+	
+private:
+	vector<Message> messages;
+	vector<TextLine> lines;
+	
+	// Storage for the message text, and for the text that is repeated.
+	Arena text;
+	StringTable paths;
+	StringTable headers;
+	// The translation units of each message that occurred in more than one,
+	// other than the first, as path IDs.
+	unordered_map<int, vector<int>> units;
+	// Buffers for building header lines and for normalizing paths, reused to
+	// avoid allocations.
+	string header;
+	vector<string_view> components;
+};
+
+
+
+#endif
@@ -0,0 +1,208 @@
+/* OutputLog.cpp
+Michael Zahniser, 17 Oct 2026
+*/
+
+#include "OutputLog.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+	// How many of the most recent lines are kept in memory.
+	const size_t TAIL_LINES = 1024;
+	// How often the file offset of a line is recorded.
+	const size_t CHECKPOINT_LINES = 64;
+	// How much text to buffer before writing it to the log file.
+	const size_t BUFFER_SIZE = 65536;
+	
+	// Create a temporary file that is deleted as soon as it is closed.
+	int CreateTemporaryFile()
+	{
+		const char *dir = getenv("TMPDIR");
+		string path = (dir && *dir ? dir : "/tmp") + string("/gorp-XXXXXX");
+		int fd = mkostemp(&path[0], O_CLOEXEC);
+		if(fd >= 0)
+			unlink(path.data());
+		return fd;
+	}
+}
+
+
+
+OutputLog::~OutputLog()
+{
+	Unmap();
+	if(fd >= 0)
+		close(fd);
+}
+
+
+
+// Discard all the lines in the log.
+void OutputLog::Clear()
+{
+	Unmap();
+	if(fd >= 0 && (ftruncate(fd, 0) || lseek(fd, 0, SEEK_SET)))
+	{
+		close(fd);
+		fd = -1;
+	}
+	written = 0;
+	buffer.clear();
+	isFull = false;
+	checkpoints.clear();
+	tail.clear();
+	count = 0;
+}
+
+
+
+// Add a line to the end of the log.
+void OutputLog::Add(string_view line)
+{
+	if(tail.size() < TAIL_LINES)
+		tail.emplace_back(line);
+	else
+		tail[count % TAIL_LINES] = line;
+	
+	// The log file is only created once there is something to put in it.
+	if(fd < 0 && !count)
+		fd = CreateTemporaryFile();
+	if(fd >= 0 && !isFull)
+	{
+		if(!(count % CHECKPOINT_LINES))
+			checkpoints.push_back(written + buffer.size());
+		buffer.append(line);
+		buffer += '\n';
+		if(buffer.size() >= BUFFER_SIZE)
+			Flush();
+	}
+	++count;
+}
+
+
+
+// Get the number of lines in the log.
+size_t OutputLog::Size() const
+{
+	return count;
+}
+
+
+
+// Get the line with the given index.
+string_view OutputLog::Line(size_t index)
+{
+	if(index >= count)
+		return string_view();
+	
+	// Recent lines are still in memory.
+	if(count - index <= tail.size())
+		return tail[index % TAIL_LINES];
+	
+	// Older lines must be read from the log file. Find the nearest checkpoint
+	// at or before this line, then skip forward to the line itself.
+	size_t checkpoint = index / CHECKPOINT_LINES;
+	if(checkpoint >= checkpoints.size() || !Map())
+		return string_view();
+	const char *it = map + min<uint64_t>(checkpoints[checkpoint], mapSize);
+	const char *end = map + mapSize;
+	for(size_t skip = index % CHECKPOINT_LINES; skip && it < end; --skip)
+	{
+		const void *next = memchr(it, '\n', end - it);
+		it = (next ? static_cast<const char *>(next) + 1 : end);
+	}
+	
+	const char *lineEnd = static_cast<const char *>(memchr(it, '\n', end - it));
+	return string_view(it, (lineEnd ? lineEnd : end) - it);
+}
+
+
+
+// Get an estimate of the number of bytes of memory used by the log.
+size_t OutputLog::Capacity() const
+{
+	size_t capacity = tail.capacity() * sizeof(string) + buffer.capacity()
+		+ checkpoints.capacity() * sizeof(uint64_t);
+	for(const string &line : tail)
+		capacity += line.capacity();
+	return capacity;
+}
+
+
+
+// Get the size of the file holding the full log.
+uint64_t OutputLog::FileSize() const
+{
+	return written + buffer.size();
+}
+
+
+
+// Write any buffered text to the log file.
+void OutputLog::Flush()
+{
+	const char *it = buffer.data();
+	size_t remaining = buffer.size();
+	while(remaining)
+	{
+		ssize_t length = write(fd, it, remaining);
+		if(length < 0 && errno == EINTR)
+			continue;
+		if(length <= 0)
+			break;
+		it += length;
+		remaining -= length;
+		written += length;
+	}
+	buffer.clear();
+	
+	// If not everything could be written, the lines that were not are lost, so
+	// forget where they start.
+	if(remaining)
+	{
+		isFull = true;
+		while(!checkpoints.empty() && checkpoints.back() >= written)
+			checkpoints.pop_back();
+	}
+}
+
+
+
+// Make sure everything written to the log file is memory-mapped.
+bool OutputLog::Map()
+{
+	if(fd < 0)
+		return false;
+	
+	Flush();
+	if(map && mapSize == written)
+		return true;
+	
+	Unmap();
+	void *result = mmap(nullptr, written, PROT_READ, MAP_SHARED, fd, 0);
+	if(result == MAP_FAILED)
+		return false;
+	map = static_cast<char *>(result);
+	mapSize = written;
+	return true;
+}
+
+
+
+// Release the memory-mapped view of the log file.
+void OutputLog::Unmap()
+{
+	if(map)
+		munmap(map, mapSize);
+	map = nullptr;
+	mapSize = 0;
+}
@@ -0,0 +1,81 @@
+/* OutputLog.h
+Michael Zahniser, 17 Oct 2026
+
+Class storing every line of output from the build without holding it all in
+memory. Only the most recent lines are kept in memory; the full log is written
+to an anonymous temporary file, which is memory-mapped when older lines need to
+be displayed. The offset of every few lines is recorded so that any line can be
+found quickly without keeping an index entry for each one.
+*/
+
+#ifndef OUTPUT_LOG_H_
+#define OUTPUT_LOG_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+
+
+class OutputLog {
+public:
+	OutputLog() = default;
+	OutputLog(const OutputLog &) = delete;
+	OutputLog &operator=(const OutputLog &) = delete;
+	~OutputLog();
+	
+	// Discard all the lines in the log.
+	void Clear();
+	// Add a line to the end of the log.
+	void Add(string_view line);
+	
+	// Get the number of lines in the log.
+	size_t Size() const;
+	// Get the line with the given index. The returned view remains valid until
+	// the next call to any non-const function of this log. If the line could not
+	// be saved in the log file, it is empty.
+	string_view Line(size_t index);
+	
+	// Get an estimate of the number of bytes of memory used by the log, not
+	// counting the memory-mapped file, and get the size of that file.
+	size_t Capacity() const;
+	uint64_t FileSize() const;
+	
+	
+private:
+	// Write any buffered text to the log file.
+	void Flush();
+	// Make sure everything written to the log file is memory-mapped.
+	bool Map();
+	// Release the memory-mapped view of the log file.
+	void Unmap();
+	
+	
+private:
+	// The most recent lines, in a ring buffer indexed by line index.
+	vector<string> tail;
+	// The total number of lines in the log.
+	size_t count = 0;
+	
+	// The temporary file holding the full log, and how much has been written to
+	// it. Text is buffered so that it can be written in large blocks. If writing
+	// fails (e.g. because the disk is full), nothing more is added to the file,
+	// so only the lines before that can be read from it.
+	int fd = -1;
+	uint64_t written = 0;
+	string buffer;
+	bool isFull = false;
+	// The offset in the file of every CHECKPOINT_LINES'th line.
+	vector<uint64_t> checkpoints;
+	
+	// The memory-mapped view of the log file, if it has been needed.
+	char *map = nullptr;
+	size_t mapSize = 0;
+};
+
+
+
+#endif
@@ -0,0 +1,648 @@
+/* Parser.cpp
+Michael Zahniser, 17 Oct 2026
+*/
+
+#include "Parser.h"
+
+#include "Diagnostic.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <utility>
+
+using namespace std;
+
+namespace {
+	// The number of lines of context to show after each error or warning.
+	const int CONTEXT_LINES = 2;
+	// The most include chains to remember before their messages are found.
+	const size_t MAX_ROOTS = 64;
+	
+	// Skip over any spaces at the given position in the text.
+	size_t SkipSpaces(string_view text, size_t pos)
+	{
+		while(pos < text.size() && text[pos] == ' ')
+			++pos;
+		return pos;
+	}
+	
+	// GCC prints each source excerpt as "  123 | code", and the line under it
+	// that marks a column as "      |    ^". Check whether the given line is one
+	// of those, and if it is, get the line number (or 0 for a marker line).
+	bool IsExcerpt(string_view text, int &line)
+	{
+		size_t pos = SkipSpaces(text, 0);
+		line = 0;
+		for( ; pos < text.size() && text[pos] >= '0' && text[pos] <= '9'; ++pos)
+			line = line * 10 + (text[pos] - '0');
+		pos = SkipSpaces(text, pos);
+		return (pos < text.size() && text[pos] == '|');
+	}
+	
+	// Check if the given source excerpt shows the given line of the given file.
+	// Whitespace is ignored, because GCC expands tabs in excerpts.
+	bool IsSourceLine(const string &path, int line, string_view excerpt)
+	{
+		ifstream in(path);
+		string text;
+		for(int i = 0; i < line && getline(in, text); ++i)
+			continue;
+		if(!in)
+			return false;
+		
+		excerpt.remove_prefix(min(excerpt.find('|') + 1, excerpt.size()));
+		auto IsSpace = [](char c) { return isspace(static_cast<unsigned char>(c)); };
+		text.erase(remove_if(text.begin(), text.end(), IsSpace), text.end());
+		string code(excerpt);
+		code.erase(remove_if(code.begin(), code.end(), IsSpace), code.end());
+		return (code == text);
+	}
+	
+	// The first line of an include chain names the file being compiled.
+	const string_view INCLUDED_FROM = "In file included from ";
+	// The extensions of source files, as opposed to headers.
+	const string_view SOURCE_EXTENSIONS[] = {"c", "cc", "cpp", "cxx", "c++", "C", "m", "mm"};
+	
+	// Check if the given line is the start of an include chain, which belongs to
+	// the message after it, not the one before it.
+	bool IsInclude(string_view text)
+	{
+		if(!text.compare(0, INCLUDED_FROM.size(), INCLUDED_FROM))
+			return true;
+		size_t pos = SkipSpaces(text, 0);
+		return (pos && !text.compare(pos, 5, "from "));
+	}
+	
+	// GCC prints each step of a template instantiation backtrace (and of other
+	// backtraces, such as for constexpr evaluation) as "path:line:column:" and
+	// then three spaces, e.g. "a.cpp:12:5:   required from here".
+	bool IsBacktrace(string_view text)
+	{
+		size_t pos = text.find(":   ");
+		return (pos != string_view::npos && pos && text[pos - 1] >= '0' && text[pos - 1] <= '9');
+	}
+	
+	// Check if the given line is the first line of an include chain, and if so,
+	// get the path of the file at the root of it: "In file included from a.cpp:3:"
+	bool IsIncludeRoot(string_view text, string_view &path)
+	{
+		if(text.compare(0, INCLUDED_FROM.size(), INCLUDED_FROM))
+			return false;
+		size_t end = text.find(':', INCLUDED_FROM.size());
+		if(end == string_view::npos)
+			return false;
+		path = text.substr(INCLUDED_FROM.size(), end - INCLUDED_FROM.size());
+		return true;
+	}
+	
+	// Check if the given path is a source file, rather than a header.
+	bool IsSource(string_view path)
+	{
+		size_t dot = path.rfind('.');
+		if(dot == string_view::npos || path.find('/', dot) != string_view::npos)
+			return false;
+		for(string_view extension : SOURCE_EXTENSIONS)
+			if(path.substr(dot + 1) == extension)
+				return true;
+		return false;
+	}
+	
+	// Check if the given line has the form "path: text", which GCC uses to say
+	// what function or scope the messages after it are in. If so, get its path.
+	bool IsLocation(string_view text, string_view &path)
+	{
+		size_t pos = text.find(':');
+		if(!pos || pos == string_view::npos || pos + 1 >= text.size() || text[pos + 1] != ' ')
+			return false;
+		path = text.substr(0, pos);
+		return (path.find(' ') == string_view::npos);
+	}
+	
+	// The keys in a JSON or SARIF document that have any meaning to gorp.
+	enum Key {OTHER, KIND, LEVEL, MESSAGE, TEXT, OPTION, RULE_ID, LOCATIONS,
+		CHILDREN, RESULTS, RELATED_LOCATIONS, FILE_NAME, URI, LINE, START_LINE, COLUMN,
+		START_COLUMN, START, FINISH, CONTEXT_REGION};
+	const pair<string_view, Key> KEYS[] = {
+		{"kind", KIND},
+		{"level", LEVEL},
+		{"message", MESSAGE},
+		{"text", TEXT},
+		{"option", OPTION},
+		{"ruleId", RULE_ID},
+		{"locations", LOCATIONS},
+		{"children", CHILDREN},
+		{"results", RESULTS},
+		{"relatedLocations", RELATED_LOCATIONS},
+		{"file", FILE_NAME},
+		{"uri", URI},
+		{"line", LINE},
+		{"startLine", START_LINE},
+		{"column", COLUMN},
+		{"startColumn", START_COLUMN},
+		{"start", START},
+		{"finish", FINISH},
+		{"contextRegion", CONTEXT_REGION}
+	};
+	
+	// Look up which of the above keys the given string is.
+	Key FindKey(const string &value)
+	{
+		for(const pair<string_view, Key> &it : KEYS)
+			if(value == it.first)
+				return it.second;
+		return OTHER;
+	}
+	
+	// Figure out what type of message a "kind" (GCC) or "level" (SARIF) is.
+	Message::Type TypeOf(const string &kind)
+	{
+		if(kind == "warning")
+			return Message::WARNING;
+		// GCC also has kinds such as "fatal error".
+		if(kind.find("error") != string::npos)
+			return Message::ERROR;
+		return Message::NONE;
+	}
+}
+
+
+
+// Reset the parser to begin parsing the output of a new build.
+void Parser::Clear()
+{
+	paths.Clear();
+	locations.clear();
+	messages.clear();
+	byLine.clear();
+	lastMessage = -1;
+	lastContext = -1;
+	roots.clear();
+	units.clear();
+	backtrace.Clear();
+	isCollecting = false;
+	isReadingJson = false;
+}
+
+
+
+// Parse a line that the build printed to STDERR, and add a record of it to the
+// given batch.
+void Parser::ParseError(string_view text, RecordBatch &batch)
+{
+	Record &record = batch.Add(text, true);
+	
+	// Ignore linker errors. Find "undefined reference" instead.
+	Diagnostic diagnostic;
+	if(diagnostic.Parse(text))
+	{
+		int index = messages.size();
+		if(diagnostic.type == Message::LINK)
+		{
+			record.SetMessage(diagnostic, "Linker error:", index);
+			messages.push_back(Pending{-1, -1, 0, 0});
+		}
+		else
+		{
+			// The header is whatever location was last given for this file.
+			size_t file = paths.Intern(diagnostic.file);
+			if(file == locations.size())
+				locations.emplace_back();
+			record.SetMessage(diagnostic, locations[file], index);
+			// The first message in a header after an include chain belongs to the
+			// oldest chain that has not been used yet. Later messages in the same
+			// header do not repeat the chain, so they get the same root.
+			if(!IsSource(diagnostic.file))
+			{
+				if(!roots.empty())
+				{
+					units[file] = roots.front();
+					roots.erase(roots.begin());
+				}
+				auto it = units.find(file);
+				if(it != units.end())
+					record.unit.assign(it->second);
+			}
+			messages.push_back(Pending{static_cast<int>(file), diagnostic.line, CONTEXT_LINES, 0});
+			Expect(index);
+		}
+		lastMessage = index;
+		
+		// A template instantiation backtrace is printed before the message it
+		// belongs to, so it has been held until now. (Adding to the batch may
+		// move the record, so it must not be used after this.)
+		for(size_t i = 0; i < backtrace.Size(); ++i)
+			batch.Add(backtrace[i].text, true).SetBacktrace(index, backtrace[i].depth);
+		backtrace.Clear();
+		isCollecting = false;
+		return;
+	}
+	
+	// After a location line, the lines of a backtrace and their source excerpts
+	// are held, until the message they lead up to starts. Any other line means
+	// that there is no such message.
+	int line = 0;
+	bool isExcerpt = IsExcerpt(text, line);
+	if(isCollecting && (IsBacktrace(text) || (isExcerpt && backtraceLinesAfter)))
+	{
+		backtraceLinesAfter = (isExcerpt ? backtraceLinesAfter - 1 : CONTEXT_LINES);
+		backtrace.Add(text, true).depth = (isExcerpt ? 2 : 1);
+		return;
+	}
+	backtrace.Clear();
+	isCollecting = false;
+	
+	// A note belongs to the message before it, one level down in its tree, and
+	// so does a backtrace that comes after the message (explaining a note).
+	// Either can have source excerpts of its own.
+	if((diagnostic.isNote || IsBacktrace(text)) && lastMessage >= 0)
+	{
+		Pending &pending = messages[lastMessage];
+		int depth = (diagnostic.isNote || !pending.depth ? 1 : 2);
+		record.SetText(lastMessage, depth);
+		Forget(lastMessage);
+		int file = (diagnostic.file.empty() ? -1 : paths.Intern(diagnostic.file));
+		pending = Pending{file, diagnostic.line, CONTEXT_LINES, depth};
+		Expect(lastMessage);
+		return;
+	}
+	
+	int message = FindContext(text);
+	string_view path;
+	if(message >= 0)
+	{
+		// A message's own source excerpt is always shown, but the excerpts of
+		// its notes are only shown along with them.
+		int depth = messages[message].depth;
+		record.SetText(message, depth ? depth + 1 : 0);
+		AddContext(message);
+	}
+	else if(IsIncludeRoot(text, path))
+	{
+		// If roots are never used, e.g. because their messages could not be
+		// parsed, only the most recent ones are kept.
+		if(roots.size() == MAX_ROOTS)
+			roots.erase(roots.begin());
+		roots.emplace_back(path);
+	}
+	else if(IsLocation(text, path))
+	{
+		size_t file = paths.Intern(path);
+		if(file == locations.size())
+			locations.emplace_back();
+		locations[file].assign(text.substr(path.size() + 2));
+		isCollecting = true;
+	}
+}
+
+
+
+// Parse a line that the build printed to STDOUT, and add a record of it to the
+// given batch.
+void Parser::ParseOutput(string_view text, RecordBatch &batch)
+{
+	batch.Add(text, false);
+}
+
+
+
+// Check if the given text, which starts at the beginning of a line printed to
+// STDERR, is the start of a JSON or SARIF document.
+bool Parser::IsJson(string_view text) const
+{
+	// GCC prints an array of diagnostics on a single line, which is empty if
+	// there were none. SARIF is an object, and may be spread over many lines.
+	if(text.empty() || (text[0] != '[' && text[0] != '{'))
+		return false;
+	bool isObject = (text[0] == '{');
+	for(size_t i = 1; i < text.size(); ++i)
+	{
+		char c = text[i];
+		if(c == '\n')
+			return isObject;
+		if(c != ' ' && c != '\t' && c != '\r')
+			return isObject ? (c == '"') : (c == '{' || c == ']');
+	}
+	return false;
+}
+
+
+
+// Parse as much of a JSON or SARIF document as possible from the given text,
+// and return the number of characters that were used.
+size_t Parser::ParseJson(string_view text, RecordBatch &batch)
+{
+	size_t size = text.size();
+	if(!isReadingJson)
+	{
+		json.Clear();
+		frames.clear();
+		isReadingJson = true;
+	}
+	while(isReadingJson)
+	{
+		JsonReader::Token token = json.Next(text);
+		if(token == JsonReader::NONE)
+			break;
+		if(token == JsonReader::ERROR)
+		{
+			// If the document is not valid, skip the rest of the line it broke on
+			// and go back to treating the output as text.
+			size_t end = text.find('\n');
+			text.remove_prefix(end == string_view::npos ? text.size() : end + 1);
+			isReadingJson = false;
+			break;
+		}
+		HandleToken(token, batch);
+		
+		// Once the document ends, so does the line it is on.
+		if(!json.Depth())
+		{
+			isReadingJson = false;
+			size_t end = text.find_first_not_of(" \t\r");
+			if(end != string_view::npos && text[end] == '\n')
+				text.remove_prefix(end + 1);
+		}
+	}
+	return size - text.size();
+}
+
+
+
+// Check if a JSON document has been started but not finished.
+bool Parser::IsReadingJson() const
+{
+	return isReadingJson;
+}
+
+
+
+// Figure out which message the given line is context for, if any.
+int Parser::FindContext(string_view text) const
+{
+	// A source excerpt says which line it is from, so it can be matched to its
+	// message even if other messages were printed in between. The marker line
+	// under it belongs to the same message.
+	int line = 0;
+	if(IsExcerpt(text, line))
+	{
+		int message = lastContext;
+		if(line)
+		{
+			auto it = byLine.find(line);
+			if(it == byLine.end())
+				message = lastMessage;
+			else
+			{
+				// If messages in several files refer to this line, check which
+				// of the files it is from.
+				const vector<int> &candidates = it->second;
+				message = candidates.front();
+				if(candidates.size() > 1)
+					for(int candidate : candidates)
+						if(messages[candidate].file >= 0
+								&& IsSourceLine(string(paths.Get(messages[candidate].file)), line, text))
+						{
+							message = candidate;
+							break;
+						}
+			}
+		}
+		return (message >= 0 && messages[message].linesAfter ? message : -1);
+	}
+	
+	// Otherwise, this is the old format with no line numbers. Assume that the
+	// context belongs to the most recent message, unless the line looks like
+	// the start of some other message.
+	string_view path;
+	if(lastMessage < 0 || !messages[lastMessage].linesAfter || IsInclude(text) || IsLocation(text, path))
+		return -1;
+	return lastMessage;
+}
+
+
+
+// Add a line of context to the given message.
+void Parser::AddContext(int message)
+{
+	lastContext = message;
+	// Once a message has all its context, stop looking it up by line.
+	if(!--messages[message].linesAfter)
+		Forget(message);
+}
+
+
+
+// Start looking up the given message by the line it refers to, in place of
+// any other message that refers to the same line of the same file.
+void Parser::Expect(int message)
+{
+	const Pending &pending = messages[message];
+	if(pending.line < 0)
+		return;
+	
+	vector<int> &list = byLine[pending.line];
+	for(size_t i = 0; i < list.size(); ++i)
+		if(messages[list[i]].file == pending.file)
+		{
+			list.erase(list.begin() + i);
+			break;
+		}
+	list.push_back(message);
+}
+
+
+
+// Stop looking up the given message by the line it refers to.
+void Parser::Forget(int message)
+{
+	auto it = byLine.find(messages[message].line);
+	if(it == byLine.end())
+		return;
+	
+	vector<int> &list = it->second;
+	list.erase(remove(list.begin(), list.end(), message), list.end());
+	if(list.empty())
+		byLine.erase(it);
+}
+
+
+
+// Handle the next token of a JSON document.
+void Parser::HandleToken(JsonReader::Token token, RecordBatch &batch)
+{
+	if(token == JsonReader::KEY)
+	{
+		key = FindKey(json.Value());
+		return;
+	}
+	if(token == JsonReader::END_OBJECT || token == JsonReader::END_ARRAY)
+	{
+		if(frames.back().isEntry && frames.back().entry == 0)
+			AddJsonDiagnostic(batch);
+		else if(frames.back().isEntry)
+			++noteCount;
+		frames.pop_back();
+		return;
+	}
+	
+	// Values in arrays have no key.
+	Frame *parent = (frames.empty() ? nullptr : &frames.back());
+	if(parent && parent->isArray)
+	{
+		key = OTHER;
+		++parent->count;
+	}
+	
+	if(token == JsonReader::BEGIN_OBJECT || token == JsonReader::BEGIN_ARRAY)
+	{
+		Frame frame = {key, token == JsonReader::BEGIN_ARRAY, 0, false, -1, false, false};
+		if(parent)
+		{
+			frame.entry = parent->entry;
+			frame.isLocation = parent->isLocation || (parent->key == LOCATIONS && parent->count == 1);
+			frame.isIgnored = parent->isIgnored || key == START || key == FINISH || key == CONTEXT_REGION;
+		}
+		if(!frame.isArray && parent && parent->isArray)
+		{
+			// GCC's diagnostics are in an array at the top of the document, and
+			// SARIF's are in each run's "results" array. Notes are in an array
+			// inside the diagnostic they are attached to.
+			if(parent->entry < 0 && (frames.size() == 1 || parent->key == RESULTS))
+			{
+				frame.isEntry = true;
+				frame.entry = 0;
+				diagnostic.Clear();
+				noteCount = 0;
+			}
+			else if(parent->entry == 0 && (parent->key == CHILDREN || parent->key == RELATED_LOCATIONS))
+			{
+				frame.isEntry = true;
+				frame.entry = 1;
+				if(noteCount == notes.size())
+					notes.emplace_back();
+				notes[noteCount].Clear();
+				notes[noteCount].kind = "note";
+				// A SARIF related location is also the location of its note.
+				frame.isLocation = (parent->key == RELATED_LOCATIONS);
+				frame.isIgnored = false;
+			}
+		}
+		frames.push_back(frame);
+	}
+	else
+		HandleValue(json.Value());
+}
+
+
+
+// Handle a string or literal value in a JSON document.
+void Parser::HandleValue(const string &value)
+{
+	const Frame &frame = frames.back();
+	if(frame.entry < 0)
+		return;
+	Entry &entry = (frame.entry ? notes[noteCount] : diagnostic);
+	
+	if(frame.isEntry)
+	{
+		if(key == KIND || key == LEVEL)
+			entry.kind = value;
+		else if(key == MESSAGE)
+			entry.message = value;
+		else if(key == OPTION || key == RULE_ID)
+			entry.option = value;
+	}
+	// SARIF's message is an object, with the text inside of it.
+	else if(key == TEXT && frame.key == MESSAGE && frames[frames.size() - 2].isEntry)
+		entry.message = value;
+	else if(frame.isLocation && !frame.isIgnored)
+	{
+		// Only the first file, line, and column are used, since SARIF also has
+		// locations in the form of line and column ranges.
+		if((key == FILE_NAME || key == URI) && entry.file.empty())
+		{
+			size_t start = (!value.compare(0, 7, "file://") ? 7 : 0);
+			entry.file.assign(value, start, string::npos);
+		}
+		else if((key == LINE || key == START_LINE) && entry.line < 0)
+			entry.line = atoi(value.c_str());
+		else if((key == COLUMN || key == START_COLUMN) && entry.column < 0)
+			entry.column = atoi(value.c_str());
+	}
+}
+
+
+
+// Add records for the diagnostic that has just been read from a JSON document,
+// and for the notes attached to it.
+void Parser::AddJsonDiagnostic(RecordBatch &batch)
+{
+	Record &record = batch.Add(Format(diagnostic), true);
+	Message::Type type = TypeOf(diagnostic.kind);
+	int index = lastMessage;
+	if(type == Message::NONE)
+	{
+		// A note by itself belongs to the message before it.
+		if(index >= 0)
+			record.SetText(index, 1);
+	}
+	else
+	{
+		Diagnostic result;
+		result.text = record.text;
+		result.type = type;
+		result.file = result.text.substr(0, diagnostic.file.size());
+		result.line = diagnostic.line;
+		result.column = diagnostic.column;
+		
+		index = messages.size();
+		record.SetMessage(result, string_view(), index);
+		messages.push_back(Pending{-1, diagnostic.line, 0, 0});
+		lastMessage = index;
+	}
+	
+	for(size_t i = 0; i < noteCount; ++i)
+	{
+		Record &note = batch.Add(Format(notes[i]), true);
+		if(index >= 0)
+			note.SetText(index, 1);
+	}
+}
+
+
+
+// Get the text to display for a diagnostic or note read from JSON. This is the
+// same as what the compiler would have printed if not asked for JSON.
+const string &Parser::Format(const Entry &entry)
+{
+	text.clear();
+	if(!entry.file.empty())
+	{
+		text += entry.file;
+		if(entry.line >= 0)
+			text += ':' + to_string(entry.line);
+		if(entry.line >= 0 && entry.column >= 0)
+			text += ':' + to_string(entry.column);
+		text += ": ";
+	}
+	text += entry.kind;
+	text += ": ";
+	text += entry.message;
+	if(!entry.option.empty())
+		text += " [" + entry.option + "]";
+	return text;
+}
+
+
+
+void Parser::Entry::Clear()
+{
+	kind.clear();
+	message.clear();
+	option.clear();
+	file.clear();
+	line = -1;
+	column = -1;
+}
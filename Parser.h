@@ -0,0 +1,174 @@
+/* Parser.h
+Michael Zahniser, 17 Oct 2026
+
+Class that parses the output of a build, line by line, and decides which lines
+are the start of an error or warning message and which lines belong with the
+message before them. The results are written into batches of records.
+
+In a parallel build, the output of several compiler processes is interleaved,
+so the parser keeps separate state for each source file, keyed by its path, and
+uses the line numbers in source excerpts to match them to their messages. It
+also keeps track of which source file included the header each message is in,
+so that repeats of the same message can be traced to the files they came from.
+Notes and template instantiation backtraces are kept in full, as children of
+the message they belong to.
+
+Compilers can also print their diagnostics as JSON (GCC) or SARIF (GCC and
+Clang). That output is read as a stream rather than line by line, and each
+diagnostic is turned into the same records that the text output would give.
+*/
+
+#ifndef PARSER_H_
+#define PARSER_H_
+
+#include "JsonReader.h"
+#include "Record.h"
+#include "StringTable.h"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+
+
+class Parser {
+public:
+	// Reset the parser to begin parsing the output of a new build.
+	void Clear();
+	
+	// Parse a line that the build printed to STDERR or STDOUT, and add a record
+	// of it to the given batch.
+	void ParseError(string_view text, RecordBatch &batch);
+	void ParseOutput(string_view text, RecordBatch &batch);
+	
+	// Check if the given text, which starts at the beginning of a line printed
+	// to STDERR, is the start of a JSON or SARIF document. If the first line of
+	// it has not been fully received yet, this may return false.
+	bool IsJson(string_view text) const;
+	// Parse as much of a JSON or SARIF document as possible from the given text,
+	// and return the number of characters that were used. The rest of the
+	// document can be given in later calls, until it has all been read.
+	size_t ParseJson(string_view text, RecordBatch &batch);
+	// Check if a JSON document has been started but not finished.
+	bool IsReadingJson() const;
+	
+	
+private:
+	// A message that may still have lines of context to come.
+	class Pending {
+	public:
+		// The file and line that the message (or its latest note) refers to.
+		// The file is the ID of its path, or -1 if it has none.
+		int file;
+		int line;
+		// How many more lines of context it can have.
+		int linesAfter;
+		// The depth of the last line added to it that was not context: 0 for
+		// the message itself, and more for its notes and backtraces.
+		int depth;
+	};
+	
+	// A diagnostic, or a note attached to one, read from a JSON document.
+	class Entry {
+	public:
+		void Clear();
+		
+	public:
+		string kind;
+		string message;
+		string option;
+		string file;
+		int line;
+		int column;
+	};
+	
+	// An object or array that the JSON reader is currently inside of.
+	class Frame {
+	public:
+		// The key this object or array is the value of, if any.
+		int key;
+		bool isArray;
+		// For an array, the number of values in it so far.
+		int count;
+		// Whether this is the object for a diagnostic or note, or is inside one.
+		bool isEntry;
+		int entry;
+		// Whether this is inside the first location of a diagnostic or note, and
+		// whether it is inside a part of the location that should be ignored.
+		bool isLocation;
+		bool isIgnored;
+	};
+	
+	
+private:
+	// Figure out which message the given line is context for, if any.
+	int FindContext(string_view text) const;
+	// Add a line of context to the given message.
+	void AddContext(int message);
+	// Start or stop looking up the given message by the line it refers to.
+	void Expect(int message);
+	void Forget(int message);
+	
+	// Handle the next token of a JSON document.
+	void HandleToken(JsonReader::Token token, RecordBatch &batch);
+	// Handle a string or literal value in a JSON document.
+	void HandleValue(const string &value);
+	// Add records for the diagnostic that has just been read from a JSON
+	// document, and for the notes attached to it.
+	void AddJsonDiagnostic(RecordBatch &batch);
+	// Get the text to display for a diagnostic or note read from JSON.
+	const string &Format(const Entry &entry);
+	
+	
+private:
+	// The most recent "In function" (etc.) line for each file, indexed by the
+	// ID of the file's path.
+	StringTable paths;
+	vector<string> locations;
+	
+	// Each message that has been found, and for the messages that are still
+	// waiting for context, their index by the line they refer to. There is at
+	// most one for each file and line, but messages in different files may
+	// refer to the same line. A source excerpt only gives the line number, not
+	// the file, so when there are several messages it could belong to, the one
+	// whose file has the same text on that line is chosen, if that can be
+	// read. If it cannot be, or several of them match, the excerpt is given to
+	// the one that was printed first, which may be the wrong one.
+	vector<Pending> messages;
+	unordered_map<int, vector<int>> byLine;
+	// The most recent message, and the most recent one to get a source line.
+	int lastMessage = -1;
+	int lastContext = -1;
+	// The source files at the roots of the include chains that have not been
+	// followed by their messages yet, in order, and the source file that last
+	// included each header that had a message, indexed by its path's ID. An
+	// include chain is only printed when it changes, so if messages in several
+	// headers are interleaved, a message that has no chain of its own may be
+	// given the root of another compiler's chain.
+	vector<string> roots;
+	unordered_map<int, string> units;
+	// A backtrace that may lead up to a message, and whether one is being read
+	// (which it may be after any location line), and how many more lines of
+	// context its last line can have.
+	RecordBatch backtrace;
+	bool isCollecting = false;
+	int backtraceLinesAfter = 0;
+	
+	// The state of the JSON document that is being read, if any.
+	JsonReader json;
+	bool isReadingJson = false;
+	vector<Frame> frames;
+	int key = 0;
+	// The diagnostic that is being read from it, and the notes attached to it.
+	Entry diagnostic;
+	vector<Entry> notes;
+	size_t noteCount = 0;
+	string text;
+};
+
+
+
+#endif
@@ -4,13 +4,79 @@ Michael Zahniser, 19 Dec 2018
 
 #include "Process.h"
 
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+
+#include <fcntl.h>
 #include <signal.h>
-#include <sys/select.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
 using namespace std;
 
+namespace {
+	// How long a killed process has to exit before it is sent SIGKILL.
+	const chrono::milliseconds KILL_DELAY(1000);
+	
+	// Write all of the given text to the given file descriptor, even if it does
+	// not all fit in the pipe at once. Return false if an error occurs.
+	bool WriteAll(int fd, const char *text, size_t size)
+	{
+		while(size)
+		{
+			ssize_t written = write(fd, text, size);
+			if(written < 0 && errno == EINTR)
+				continue;
+			if(written <= 0)
+				return false;
+			text += written;
+			size -= written;
+		}
+		return true;
+	}
+	
+	// Copy the given log file into the given file descriptor. Each line of the
+	// timing file, if any, gives a delay in seconds and then how many bytes of
+	// the log to write after that delay. Once the timing runs out, the rest of
+	// the log is written as fast as possible.
+	void WriteLog(const string &logPath, const string &timingPath, int fd)
+	{
+		int log = open(logPath.c_str(), O_RDONLY);
+		if(log < 0)
+			return;
+		FILE *timing = (timingPath.empty() ? nullptr : fopen(timingPath.c_str(), "r"));
+		
+		static char buffer[65536];
+		double delay = 0.;
+		size_t count = 0;
+		while(true)
+		{
+			if(timing && fscanf(timing, "%lf %zu", &delay, &count) == 2)
+			{
+				timespec duration;
+				duration.tv_sec = delay;
+				duration.tv_nsec = (delay - duration.tv_sec) * 1e9;
+				while(nanosleep(&duration, &duration) && errno == EINTR)
+					continue;
+			}
+			else
+				count = sizeof(buffer);
+			
+			// Copy the given number of bytes, in chunks as big as the buffer.
+			while(count)
+			{
+				ssize_t length = read(log, buffer, min(count, sizeof(buffer)));
+				if(length < 0 && errno == EINTR)
+					continue;
+				if(length <= 0 || !WriteAll(fd, buffer, length))
+					return;
+				count -= length;
+			}
+		}
+	}
+}
+
 
 
 // Start a process by calling the given shell command.
@@ -18,11 +84,13 @@ void Process::Start(const string &command)
 {
 	// Clear any previously buffered output and kill any previous process.
 	Kill();
-	output.clear();
-	errors.clear();
+	output.Clear();
+	errors.Clear();
 	
 	// Copy the strings into an array of character pointers.
 	Tokenize(command);
+	// Until the process exits, it is treated as if it could not be started.
+	exitStatus = 127;
 	
 	// Create the pipes.
 	if(pipe(outPipe) || pipe(errPipe))
@@ -41,6 +109,9 @@ void Process::Start(const string &command)
 		// We're in the child process now. Close the other end of the pipes.
 		close(outPipe[0]);
 		close(errPipe[0]);
+		// Start a new process group, so everything this process starts can be
+		// killed along with it.
+		setpgid(0, 0);
 		// Redirect STDOUT and STRERR into the pipes.
 		dup2(outPipe[1], 1);
 		dup2(errPipe[1], 2);
@@ -49,10 +120,14 @@ void Process::Start(const string &command)
 		
 		// Launch the process.
 		execvp(argv[0], &argv[0]);
+		_exit(127);
 	}
 	else if(process > 0)
 	{
-		// We're in the parent process now. Close the other end of the pipes.
+		// We're in the parent process now. The process group is also set here,
+		// in case this process tries to kill it before the child has set it.
+		setpgid(process, process);
+		// Close the other end of the pipes.
 		close(outPipe[1]);
 		close(errPipe[1]);
 	}
@@ -60,22 +135,121 @@ void Process::Start(const string &command)
 
 
 
-// Read a line of text from STDOUT. This function will block until either the
-// process has ended, or at least one line has been read from STDOUT or STDERR.
-// If nothing is available from STDOUT, an empty string is returned.
-string Process::ReadOutput()
+// Instead of running a command, start a process that replays the output of a
+// build that was saved to a log file.
+void Process::Replay(const string &log, const string &timing)
+{
+	Kill();
+	output.Clear();
+	errors.Clear();
+	exitStatus = 127;
+	
+	if(pipe(outPipe) || pipe(errPipe))
+		return;
+	
+	process = fork();
+	if(process < 0)
+	{
+		process = 0;
+		return;
+	}
+	else if(!process)
+	{
+		setpgid(0, 0);
+		// Nothing is written to STDOUT, so that pipe is closed right away.
+		close(outPipe[0]);
+		close(errPipe[0]);
+		close(outPipe[1]);
+		WriteLog(log, timing, errPipe[1]);
+		_exit(0);
+	}
+	setpgid(process, process);
+	close(outPipe[1]);
+	close(errPipe[1]);
+}
+
+
+
+// Get the file descriptor of the pipe connected to the process's STDOUT, or -1
+// if that pipe has reached the end of its input.
+int Process::OutputPipe() const
+{
+	return outPipe[0];
+}
+
+
+
+// Get the file descriptor of the pipe connected to the process's STDERR, or -1
+// if that pipe has reached the end of its input.
+int Process::ErrorPipe() const
+{
+	return errPipe[0];
+}
+
+
+
+// Read whatever text is available from the pipes that are flagged as being
+// ready, and check whether the process has exited. This never blocks, because
+// a single read() from a pipe that poll() says is ready returns immediately.
+void Process::Poll(bool outputReady, bool errorReady)
+{
+	if(!process)
+		return;
+	
+	if(outputReady)
+		ReadFromPipe(outPipe[0], output);
+	if(errorReady)
+		ReadFromPipe(errPipe[0], errors);
+	
+	// Once both pipes are closed, the process is done as soon as it exits. If it
+	// has not exited yet, SIGCHLD will wake up the caller to check again.
+	int status = 0;
+	if(outPipe[0] < 0 && errPipe[0] < 0 && waitpid(process, &status, WNOHANG))
+	{
+		exitStatus = (WIFSIGNALED(status) ? 128 + WTERMSIG(status) : WEXITSTATUS(status));
+		process = 0;
+	}
+}
+
+
+
+// Read a line of text from STDOUT, if a full line is available.
+bool Process::ReadOutput(string_view &line)
 {
-	return Read(output);
+	return output.NextLine(line);
 }
 
 
 
-// Read a line of text from STDERR. This function will block until either the
-// process has ended, or at least one line has been read from STDOUT or STDERR.
-// If nothing is available from STDERR, an empty string is returned.
-string Process::ReadError()
+// Read a line of text from STDERR, if a full line is available.
+bool Process::ReadError(string_view &line)
 {
-	return Read(errors);
+	return errors.NextLine(line);
+}
+
+
+
+// Get all the text that has been received from STDERR and not read yet.
+bool Process::PeekError(string_view &text) const
+{
+	text = errors.Peek();
+	return !text.empty();
+}
+
+
+
+// Discard the given amount of text from STDERR.
+void Process::ConsumeError(size_t count)
+{
+	errors.Consume(count);
+}
+
+
+
+// Check if a full line of text is available from either STDOUT or STDERR.
+bool Process::HasLine() const
+{
+	return output.HasLine() || errors.HasLine();
 }
 
 
@@ -83,7 +257,31 @@ string Process::ReadError()
 // Check if the process has finished (or has not yet been started).
 bool Process::IsDone() const
 {
-	return !process && output.empty() && errors.empty();
+	return !process && output.IsEmpty() && errors.IsEmpty();
+}
+
+
+
+// Once the process is done, get its exit status the way a shell reports it.
+int Process::ExitStatus() const
+{
+	return exitStatus;
+}
+
+
+
+// Get the number of bytes of output that have been received but not read yet.
+size_t Process::Buffered() const
+{
+	return output.Size() + errors.Size();
+}
+
+
+
+// Get the number of bytes of memory allocated to hold the output.
+size_t Process::BufferCapacity() const
+{
+	return output.Capacity() + errors.Capacity();
 }
 
 
@@ -133,79 +331,84 @@ void Process::Tokenize(const string &command)
 
 
 
-// Extract one line of text from the given buffer. Assume that the output is
-// always terminated by a newline before the EOF character.
-string Process::Read(string &buffer)
+// Read some text from the given pipe into the given buffer. If the pipe has
+// reached the end of its input, close it. When a pipe is closed, any partial
+// line left in its buffer is terminated, so the output always ends with a full
+// line.
+void Process::ReadFromPipe(int &fd, LineBuffer &buffer)
 {
-	WaitForPipes();
+	if(fd < 0)
+		return;
 	
-	// See if a full line of text is contained in this buffer.
-	string line;
-	size_t pos = buffer.find('\n');
-	if(pos != string::npos)
-	{
-		// Slice out this line of text and return it.
-		line = buffer.substr(0, pos);
-		buffer.erase(0, pos + 1);
-	}
-	return line;
+	ssize_t length = buffer.ReadFrom(fd);
+	if(length > 0 || (length < 0 && errno == EINTR))
+		return;
+	
+	close(fd);
+	fd = -1;
+	buffer.Finish();
 }
 
 
 
-// Wait until either at least a line of output has been read from one of the
-// pipes, or the process has exited.
-void Process::WaitForPipes()
+// Kill the process (if it's still running) and everything it started, without
+// waiting for them to exit.
+void Process::Kill()
 {
-	while(true)
+	if(process)
 	{
-		// Check if either buffer contains a full line of text.
-		if(!process || output.find('\n') != string::npos || errors.find('\n') != string::npos)
-			return;
-		
-		// Wait until input is available in at least one of the pipes.
-		fd_set fds;
-		FD_ZERO(&fds);
-		FD_SET(outPipe[0], &fds);
-		FD_SET(errPipe[0], &fds);
-		int nfds = max(outPipe[0], errPipe[0]) + 1;
-		select(nfds, &fds, nullptr, nullptr, nullptr);
-		
-		// Read whatever output is ready.
-		if(FD_ISSET(outPipe[0], &fds))
-			ReadFromPipe(outPipe[0], output);
-		if(FD_ISSET(errPipe[0], &fds))
-			ReadFromPipe(errPipe[0], errors);
-		
-		// If the read returned nothing, we're at the end of the input.
-		if(output.empty() && errors.empty())
-		{
-			CleanUp();
-			return;
-		}
+		killpg(process, SIGTERM);
+		dying.push_back(Dying{process, chrono::steady_clock::now() + KILL_DELAY});
 	}
+	CleanUp();
 }
 
 
 
-// Read some text from the given pipe into the given buffer.
-void Process::ReadFromPipe(int fd, string &buffer)
+// Check on the processes that have been killed but have not exited yet, and
+// escalate to SIGKILL for any that have had long enough to exit. SIGCHLD is
+// sent when one of them exits, so the caller knows when to check again before
+// the returned timeout.
+int Process::Reap()
 {
-	char b[1024];
-	int length = read(fd, b, sizeof(b));
-	if(length > 0)
-		buffer.append(b, length);
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	chrono::steady_clock::duration next = chrono::steady_clock::duration::max();
+	for(size_t i = 0; i < dying.size(); )
+	{
+		Dying &it = dying[i];
+		if(waitpid(it.process, nullptr, WNOHANG))
+		{
+			// Once the first process has exited, anything it started that is
+			// still running has been orphaned, and has no reason to keep going.
+			killpg(it.process, SIGKILL);
+			it = dying.back();
+			dying.pop_back();
+			continue;
+		}
+		if(now >= it.deadline)
+		{
+			// Keep checking until the process has actually exited.
+			killpg(it.process, SIGKILL);
+			it.deadline = now + KILL_DELAY;
+		}
+		next = min(next, it.deadline - now);
+		++i;
+	}
+	return (dying.empty() ? -1 : chrono::ceil<chrono::milliseconds>(next).count());
 }
 
 
 
-// Kill the process (if it's still running).
-void Process::Kill()
+// Wait for all the killed processes to exit.
+void Process::ReapAll()
 {
-	if(process)
+	while(true)
 	{
-		kill(process, SIGTERM);
-		CleanUp();
+		int timeout = Reap();
+		if(timeout < 0)
+			break;
+		// Check often, so that this returns soon after they exit.
+		usleep(1000 * min(timeout, 10));
 	}
 }
 
@@ -214,8 +417,11 @@ void Process::Kill()
 // Clean up the pipes, etc.
 void Process::CleanUp()
 {
-	wait(nullptr);
-	close(outPipe[0]);
-	close(errPipe[0]);
+	if(outPipe[0] >= 0)
+		close(outPipe[0]);
+	if(errPipe[0] >= 0)
+		close(errPipe[0]);
+	outPipe[0] = -1;
+	errPipe[0] = -1;
 	process = 0;
 }
@@ -2,13 +2,22 @@
 Michael Zahniser, 19 Dec 2018
 
 Class for launching a process and reading, line by line, anything it prints to
-STDOUT or STDERR. 
+STDOUT or STDERR. The process can also be one that replays a saved build log.
+
+Each process is started in a process group of its own, so that when it is
+killed, any processes it started (e.g. the compilers run by "make -j") are
+killed too. Killing never blocks: the group is sent SIGTERM, and if it has not
+exited after a short delay, SIGKILL.
 */
 
 #ifndef PROCESS_H_
 #define PROCESS_H_
 
+#include "LineBuffer.h"
+
+#include <chrono>
 #include <string>
+#include <string_view>
 #include <vector>
 
 using namespace std;
@@ -20,48 +29,94 @@ public:
 	// Start a process by calling the given shell command. Strings within single
 	// or double quotes are supported, but escape characters in strings are not.
 	void Start(const string &command);
+	// Instead of running a command, start a process that replays the output of
+	// a build that was saved to a log file. All of it is sent to STDERR. If a
+	// timing file (in the format written by "script -t") is given, the output is
+	// paced the way it was recorded; otherwise it is sent as fast as possible.
+	void Replay(const string &log, const string &timing);
+	// Kill the process (if it's still running) and everything it started,
+	// without waiting for them to exit.
+	void Kill();
+	// Check on the processes that have been killed but have not exited yet, and
+	// escalate to SIGKILL for any that have had long enough to exit. Return the
+	// time until that next needs to be done (in milliseconds), or -1 if all of
+	// them have exited. This must be called from the thread that calls Kill().
+	int Reap();
+	// Wait for all the killed processes to exit.
+	void ReapAll();
 	
-	// Read a line of text from STDOUT or STDERR. This function will block until
-	// one or the other is available, or until the process has ended. If no new
-	// text has been received in that particular output stream, an empty string
-	// is returned. If both ReadOutput() and ReadError() return an empty string,
-	// the process has stopped and all output has been returned.
-	string ReadOutput();
-	string ReadError();
+	// Get the file descriptors of the pipes that the process's STDOUT and STDERR
+	// are connected to, so the caller can wait for them to have input. If a pipe
+	// has reached the end of its input, -1 is returned for it instead.
+	int OutputPipe() const;
+	int ErrorPipe() const;
+	// Read whatever text is available from the pipes that are flagged as being
+	// ready, and check whether the process has exited. This never blocks.
+	void Poll(bool outputReady, bool errorReady);
+	
+	// Read a line of text from STDOUT or STDERR, if a full line has been
+	// received. The returned line does not include the terminating '\n'. If no
+	// full line is available, this returns false. This never blocks. The line
+	// is a view into the output buffer, which remains valid until the next call
+	// to Poll() or Start().
+	bool ReadOutput(string_view &line);
+	bool ReadError(string_view &line);
+	// Get all the text that has been received from STDERR and not read yet,
+	// even if it is not a full line, and then discard however much of it was
+	// used. This returns false if there is no text available.
+	bool PeekError(string_view &text) const;
+	void ConsumeError(size_t count);
+	// Check if a full line of text is available from either STDOUT or STDERR.
+	bool HasLine() const;
 	
 	// Check if the process has finished (or has not yet been started).
 	bool IsDone() const;
+	// Once the process is done, get its exit status the way a shell reports
+	// it: its exit code, or 128 plus the number of the signal that killed it.
+	// If it could not be started, this is 127.
+	int ExitStatus() const;
+	
+	// Get the number of bytes of output that have been received but not read
+	// yet, and the number of bytes of memory allocated to hold it.
+	size_t Buffered() const;
+	size_t BufferCapacity() const;
 	
 	
 private:
 	// Tokenize a command into individual arguments, and store it in argv.
 	void Tokenize(const string &command);
-	// Read a line of output from the given buffer, and return that line. The
-	// returned string does not include the terminating '\n' character, if any.
-	string Read(string &buffer);
-	// Wait until either at least a line of output has been read from one of the
-	// pipes, or the process has exited.
-	void WaitForPipes();
-	// Read some text from the given pipe into the given buffer.
-	void ReadFromPipe(int fd, string &buffer);
-	// Kill the process (if it's still running).
-	void Kill();
+	// Read some text from the given pipe into the given buffer. If the pipe has
+	// reached the end of its input, close it.
+	void ReadFromPipe(int &fd, LineBuffer &buffer);
 	// Clean up the pipes, etc.
 	void CleanUp();
 	
 	
+private:
+	// A process group that has been sent SIGTERM, and when to send it SIGKILL
+	// if the process has not exited by then.
+	class Dying {
+	public:
+		int process;
+		chrono::steady_clock::time_point deadline;
+	};
+	
+	
 private:
 	// Arguments for the process.
 	string args;
 	vector<char *> argv;
-	// Process ID.
+	// Process ID. This is cleared once the process has exited.
 	int process = 0;
+	int exitStatus = 0;
 	// Pipes for communication with the process.
 	int outPipe[2] = {-1, -1};
 	int errPipe[2] = {-1, -1};
 	// Output and errors received and queued up.
-	string output;
-	string errors;
+	LineBuffer output;
+	LineBuffer errors;
+	// Processes that have been killed, but not yet reaped.
+	vector<Dying> dying;
 };
 
 
@@ -0,0 +1,97 @@
+/* Queue.h
+Michael Zahniser, 17 Oct 2026
+
+Lock-free queue for passing values from one thread to another. Only one thread
+may push values into the queue, and only one thread may pop them. The capacity
+is fixed; pushing into a full queue fails instead of blocking.
+*/
+
+#ifndef QUEUE_H_
+#define QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+
+
+template <class T>
+class Queue {
+public:
+	// The capacity is rounded up to a power of two.
+	explicit Queue(size_t capacity);
+	
+	// Add a value to the back of the queue. Only the producer thread may call
+	// this. If the queue is full, this returns false.
+	bool Push(const T &value);
+	// Remove the value at the front of the queue. Only the consumer thread may
+	// call this. If the queue is empty, this returns false.
+	bool Pop(T &value);
+	// Check if the queue is empty. This is exact when called by the consumer,
+	// and a hint otherwise.
+	bool IsEmpty() const;
+	
+	
+private:
+	vector<T> slots;
+	size_t mask;
+	// The producer and consumer each write to one of these, so keep them on
+	// separate cache lines.
+	alignas(64) atomic<size_t> head;
+	alignas(64) atomic<size_t> tail;
+};
+
+
+
+template <class T>
+Queue<T>::Queue(size_t capacity)
+	: head(0), tail(0)
+{
+	size_t size = 1;
+	while(size < capacity)
+		size *= 2;
+	slots.resize(size);
+	mask = size - 1;
+}
+
+
+
+template <class T>
+bool Queue<T>::Push(const T &value)
+{
+	size_t back = tail.load(memory_order_relaxed);
+	if(back - head.load(memory_order_acquire) == slots.size())
+		return false;
+	
+	slots[back & mask] = value;
+	tail.store(back + 1, memory_order_release);
+	return true;
+}
+
+
+
+template <class T>
+bool Queue<T>::Pop(T &value)
+{
+	size_t front = head.load(memory_order_relaxed);
+	if(front == tail.load(memory_order_acquire))
+		return false;
+	
+	value = slots[front & mask];
+	head.store(front + 1, memory_order_release);
+	return true;
+}
+
+
+
+template <class T>
+bool Queue<T>::IsEmpty() const
+{
+	return head.load(memory_order_acquire) == tail.load(memory_order_acquire);
+}
+
+
+
+#endif
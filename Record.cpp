@@ -0,0 +1,103 @@
+/* Record.cpp
+Michael Zahniser, 17 Oct 2026
+*/
+
+#include "Record.h"
+
+using namespace std;
+
+
+
+// Make this record start a new message for the given diagnostic, which must
+// have been parsed from this record's text.
+void Record::SetMessage(const Diagnostic &diagnostic, string_view header, int index)
+{
+	action = MESSAGE;
+	this->index = index;
+	this->header.assign(header);
+	type = diagnostic.type;
+	fileLength = diagnostic.file.size();
+	line = diagnostic.line;
+	column = diagnostic.column;
+	unit.clear();
+}
+
+
+
+// Make this record add its text to the message with the given index, at the
+// given depth in the message's tree of lines.
+void Record::SetText(int index, int depth)
+{
+	action = TEXT;
+	this->index = index;
+	this->depth = depth;
+}
+
+
+
+void Record::SetBacktrace(int index, int depth)
+{
+	action = BACKTRACE;
+	this->index = index;
+	this->depth = depth;
+}
+
+
+
+// Get the diagnostic that this record's message was created from.
+void Record::GetDiagnostic(Diagnostic &diagnostic) const
+{
+	diagnostic.text = text;
+	diagnostic.type = type;
+	diagnostic.file = diagnostic.text.substr(0, fileLength);
+	diagnostic.line = line;
+	diagnostic.column = column;
+	diagnostic.body = string_view();
+}
+
+
+
+// Add a record to the batch, and return it so that it can be filled in.
+Record &RecordBatch::Add(string_view text, bool isError)
+{
+	if(size == records.size())
+		records.emplace_back();
+	
+	Record &record = records[size++];
+	record.action = Record::NONE;
+	record.text.assign(text);
+	record.isError = isError;
+	record.index = -1;
+	record.depth = 0;
+	return record;
+}
+
+
+
+// Remove all the records from the batch, keeping their memory for reuse.
+void RecordBatch::Clear()
+{
+	size = 0;
+}
+
+
+
+// Get the number of records in the batch.
+size_t RecordBatch::Size() const
+{
+	return size;
+}
+
+
+
+bool RecordBatch::IsEmpty() const
+{
+	return !size;
+}
+
+
+
+const Record &RecordBatch::operator[](size_t index) const
+{
+	return records[index];
+}
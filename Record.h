@@ -0,0 +1,95 @@
+/* Record.h
+Michael Zahniser, 17 Oct 2026
+
+Classes for passing parsed build output from the thread that reads and parses
+it to the thread that displays it. Each record is one line of output, along
+with what the parser decided to do with it: start a new message, add it to an
+existing message, or nothing. A message's lines form a tree: notes and template
+backtraces are children of the message, and their source excerpts are children
+of them. Records are sent in batches, and the batches are reused, so that once
+the strings in them have grown large enough no more memory needs to be
+allocated.
+*/
+
+#ifndef RECORD_H_
+#define RECORD_H_
+
+#include "Diagnostic.h"
+#include "Message.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+
+
+class Record {
+public:
+	// What to do with this line of output, other than displaying it. A
+	// backtrace line is added to a message like text is, but it is a copy of a
+	// line that was printed before the message started, so it is not output.
+	enum Action {NONE, MESSAGE, TEXT, BACKTRACE, DONE};
+	
+	
+public:
+	// Make this record start a new message for the given diagnostic, which must
+	// have been parsed from this record's text.
+	void SetMessage(const Diagnostic &diagnostic, string_view header, int index);
+	// Make this record add its text to the message with the given index, at
+	// the given depth in the message's tree of lines.
+	void SetText(int index, int depth);
+	void SetBacktrace(int index, int depth);
+	// Get the diagnostic that this record's message was created from.
+	void GetDiagnostic(Diagnostic &diagnostic) const;
+	
+	
+public:
+	Action action = NONE;
+	// The line of output, and whether it was printed to STDERR or STDOUT.
+	string text;
+	bool isError = false;
+	// The index of the message this line starts or is added to, and for text,
+	// its depth. Lines at depth 0 are always shown; deeper ones are only shown
+	// when the message is expanded.
+	int index = -1;
+	int depth = 0;
+	// For a new message, the header to display above it and the parts of the
+	// diagnostic. The file is always at the start of the text.
+	string header;
+	Message::Type type = Message::NONE;
+	size_t fileLength = 0;
+	int line = -1;
+	int column = -1;
+	// For a new message in a header, the source file that included it, if that
+	// is known. For a message in a source file, this is empty.
+	string unit;
+	// For the DONE record, the build command's exit status. See Process.
+	int exitStatus = 0;
+};
+
+
+
+class RecordBatch {
+public:
+	// Add a record to the batch, and return it so that it can be filled in.
+	// The record's strings keep whatever capacity they had before.
+	Record &Add(string_view text, bool isError);
+	// Remove all the records from the batch, keeping their memory for reuse.
+	void Clear();
+	
+	// Get the number of records in the batch.
+	size_t Size() const;
+	bool IsEmpty() const;
+	const Record &operator[](size_t index) const;
+	
+	
+private:
+	vector<Record> records;
+	size_t size = 0;
+};
+
+
+
+#endif
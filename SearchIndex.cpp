@@ -0,0 +1,90 @@
+/* SearchIndex.cpp
+Michael Zahniser, 17 Oct 2026
+*/
+
+#include "SearchIndex.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+
+using namespace std;
+
+namespace {
+	// Get the trigram that starts at the given position, ignoring case.
+	uint32_t Trigram(string_view text, size_t pos)
+	{
+		uint32_t trigram = 0;
+		for(size_t i = pos; i < pos + 3; ++i)
+			trigram = (trigram << 8) | tolower(static_cast<unsigned char>(text[i]));
+		return trigram;
+	}
+}
+
+
+
+// Remove all the messages from the index.
+void SearchIndex::Clear()
+{
+	lists.clear();
+}
+
+
+
+// Add some text from the message with the given index.
+void SearchIndex::Add(int index, string_view text)
+{
+	for(size_t pos = 0; pos + 3 <= text.size(); ++pos)
+	{
+		// A trigram that occurs more than once in a message is only listed once.
+		vector<int> &list = lists[Trigram(text, pos)];
+		if(list.empty() || list.back() != index)
+			list.push_back(index);
+	}
+}
+
+
+
+// Get the messages that may contain the given text, in order.
+bool SearchIndex::Find(string_view text, vector<int> &candidates) const
+{
+	candidates.clear();
+	if(text.size() < 3)
+		return false;
+	
+	// Start with the shortest list, so the intersection starts out small.
+	vector<const vector<int> *> found;
+	for(size_t pos = 0; pos + 3 <= text.size(); ++pos)
+	{
+		auto it = lists.find(Trigram(text, pos));
+		if(it == lists.end())
+			return true;
+		found.push_back(&it->second);
+	}
+	sort(found.begin(), found.end(), [](const vector<int> *a, const vector<int> *b)
+	{
+		return a->size() < b->size();
+	});
+	
+	candidates = *found.front();
+	vector<int> intersection;
+	for(size_t i = 1; i < found.size() && !candidates.empty(); ++i)
+	{
+		intersection.clear();
+		set_intersection(candidates.begin(), candidates.end(), found[i]->begin(), found[i]->end(),
+			back_inserter(intersection));
+		candidates.swap(intersection);
+	}
+	return true;
+}
+
+
+
+// Get an estimate of the number of bytes of memory the index is using.
+size_t SearchIndex::Capacity() const
+{
+	size_t capacity = lists.bucket_count() * sizeof(void *);
+	for(const auto &it : lists)
+		capacity += sizeof(it) + it.second.capacity() * sizeof(int);
+	return capacity;
+}
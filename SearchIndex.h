@@ -0,0 +1,44 @@
+/* SearchIndex.h
+Michael Zahniser, 17 Oct 2026
+
+Class for finding which messages may contain a piece of text without searching
+all of them. For each trigram (sequence of three characters, ignoring case) it
+keeps a list of the messages that contain it; any message that contains the
+text must be in the list of every trigram of the text. Messages are added in
+order as they arrive, so each list is always sorted.
+*/
+
+#ifndef SEARCH_INDEX_H_
+#define SEARCH_INDEX_H_
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+
+
+class SearchIndex {
+public:
+	// Remove all the messages from the index.
+	void Clear();
+	// Add some text from the message with the given index. A message may have
+	// several pieces of text, but they must all be added before the next one.
+	void Add(int index, string_view text);
+	// Get the messages that may contain the given text, in order. If the text
+	// is too short to look up, return false, meaning any message may.
+	bool Find(string_view text, vector<int> &candidates) const;
+	
+	// Get an estimate of the number of bytes of memory the index is using.
+	size_t Capacity() const;
+	
+	
+private:
+	unordered_map<uint32_t, vector<int>> lists;
+};
+
+
+
+#endif
@@ -0,0 +1,312 @@
+/* Server.cpp
+Michael Zahniser, 17 Oct 2026
+*/
+
+#include "Server.h"
+
+#include "Hash.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+	// The longest request a client can send. A client that sends a longer line
+	// is not speaking this protocol, so its connection is closed.
+	const size_t MAX_REQUEST = 4096;
+	// The most output that can be waiting for a client to read it. A client
+	// that falls this far behind is disconnected, rather than using up memory.
+	const size_t MAX_OUTPUT = 16 << 20;
+	
+	// Fill in the address of the socket with the given path. Return false if
+	// the path is too long to fit in it.
+	bool GetAddress(const string &path, sockaddr_un &address)
+	{
+		address = {};
+		address.sun_family = AF_UNIX;
+		if(path.size() >= sizeof(address.sun_path))
+			return false;
+		memcpy(address.sun_path, path.c_str(), path.size() + 1);
+		return true;
+	}
+}
+
+
+
+// Close all the connections, and remove the socket.
+Server::~Server()
+{
+	for(const Client &client : clients)
+		close(client.fd);
+	if(fd >= 0)
+	{
+		close(fd);
+		unlink(path.c_str());
+	}
+}
+
+
+
+// Get the path of the socket for the current directory.
+string Server::SocketPath(const string &suffix)
+{
+	char *cwd = realpath(".", nullptr);
+	char hash[17];
+	snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(Hash(cwd ? cwd : "")));
+	free(cwd);
+	
+	// Without a runtime directory, fall back to a shared temporary directory,
+	// with the user ID in the name so that users do not collide.
+	const char *runtime = getenv("XDG_RUNTIME_DIR");
+	if(runtime && *runtime)
+		return runtime + string("/gorp-") + hash + suffix + ".sock";
+	return "/tmp/gorp-" + to_string(getuid()) + "-" + hash + suffix + ".sock";
+}
+
+
+
+// Start listening on the socket with the given path. If another copy of gorp
+// is already listening on it, return false.
+bool Server::Listen(const string &path)
+{
+	sockaddr_un address;
+	if(fd >= 0 || !GetAddress(path, address))
+		return false;
+	
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if(fd < 0)
+		return false;
+	
+	// If the socket already exists, check whether anything is listening on it.
+	// If not, it was left behind by a copy of gorp that did not exit cleanly.
+	const sockaddr *generic = reinterpret_cast<const sockaddr *>(&address);
+	int result = bind(fd, generic, sizeof(address));
+	if(result && errno == EADDRINUSE)
+	{
+		int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		bool isTaken = (probe >= 0 && !connect(probe, generic, sizeof(address)));
+		if(probe >= 0)
+			close(probe);
+		if(!isTaken && !unlink(path.c_str()))
+			result = bind(fd, generic, sizeof(address));
+	}
+	// Only this user can connect, even if the socket is in a shared directory.
+	if(result || chmod(path.c_str(), S_IRUSR | S_IWUSR) || listen(fd, 16))
+	{
+		close(fd);
+		fd = -1;
+		return false;
+	}
+	this->path = path;
+	return true;
+}
+
+
+
+// Close any connections that are finished, then add the file descriptors that
+// need to be polled to the given list.
+void Server::Prepare(vector<pollfd> &fds)
+{
+	if(fd < 0)
+		return;
+	
+	for(size_t i = 0; i < clients.size(); )
+	{
+		Client &client = clients[i];
+		if(client.isBroken || (client.isDone && !client.isSubscribed && client.output.empty()))
+		{
+			close(client.fd);
+			subscribers -= client.isSubscribed;
+			client = move(clients.back());
+			clients.pop_back();
+		}
+		else
+			++i;
+	}
+	
+	fds.push_back(pollfd{fd, POLLIN, 0});
+	// Once a client has closed its end, it will always be readable, so only
+	// check whether it can be written to.
+	for(const Client &client : clients)
+	{
+		short events = (client.isDone ? 0 : POLLIN) | (client.output.empty() ? 0 : POLLOUT);
+		fds.push_back(pollfd{client.fd, events, 0});
+	}
+}
+
+
+
+// Handle the results of polling the file descriptors that Prepare() added.
+void Server::Handle(const pollfd *fds)
+{
+	if(fd < 0)
+		return;
+	
+	for(size_t i = 0; i < clients.size(); ++i)
+	{
+		Client &client = clients[i];
+		short events = fds[i + 1].revents;
+		if(events & POLLIN)
+			Read(client);
+		if(events & POLLOUT)
+			Write(client);
+		// If the client hung up completely, nothing more can be sent to it.
+		if((events & (POLLHUP | POLLERR)) && !(events & POLLIN))
+			client.isBroken = true;
+	}
+	if(fds[0].revents)
+		Accept();
+}
+
+
+
+// Get the next request that a client has sent.
+bool Server::NextRequest(Request &request)
+{
+	if(requests.empty())
+		return false;
+	
+	request = move(requests.front());
+	requests.pop_front();
+	return true;
+}
+
+
+
+// Send a line of text to the given client.
+void Server::Send(int client, string_view line)
+{
+	for(Client &it : clients)
+		if(it.id == client)
+			Queue(it, line);
+}
+
+
+
+// Have the given client receive everything that is broadcast from now on.
+void Server::Subscribe(int client)
+{
+	for(Client &it : clients)
+		if(it.id == client && !it.isSubscribed)
+		{
+			it.isSubscribed = true;
+			++subscribers;
+		}
+}
+
+
+
+// Send a line of text to every subscribed client.
+void Server::Broadcast(string_view line)
+{
+	for(Client &client : clients)
+		if(client.isSubscribed)
+			Queue(client, line);
+}
+
+
+
+// Check if there are any subscribed clients.
+bool Server::HasSubscribers() const
+{
+	return subscribers;
+}
+
+
+
+// Accept all the pending connections.
+void Server::Accept()
+{
+	while(true)
+	{
+		int client = accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if(client < 0)
+			break;
+		clients.push_back(Client{client, nextId++});
+	}
+}
+
+
+
+// Read whatever requests a client has sent.
+void Server::Read(Client &client)
+{
+	char buffer[4096];
+	while(true)
+	{
+		ssize_t length = recv(client.fd, buffer, sizeof(buffer), 0);
+		if(length < 0 && errno == EINTR)
+			continue;
+		if(length < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+			client.isBroken = true;
+		if(length == 0)
+			client.isDone = true;
+		if(length <= 0)
+			break;
+		client.input.append(buffer, length);
+	}
+	
+	// Each line is one request. Leading and trailing whitespace is ignored.
+	size_t start = 0;
+	for(size_t end = client.input.find('\n'); end != string::npos; end = client.input.find('\n', start))
+	{
+		size_t first = client.input.find_first_not_of(" \t\r", start);
+		if(first < end)
+		{
+			size_t last = client.input.find_last_not_of(" \t\r", end - 1);
+			requests.push_back(Request{client.id, client.input.substr(first, last + 1 - first)});
+		}
+		start = end + 1;
+	}
+	client.input.erase(0, start);
+	if(client.input.size() > MAX_REQUEST)
+		client.isBroken = true;
+}
+
+
+
+// Send as much of a client's output as fits in its socket buffer.
+void Server::Write(Client &client)
+{
+	size_t sent = 0;
+	while(sent < client.output.size())
+	{
+		ssize_t length = send(client.fd, client.output.data() + sent, client.output.size() - sent, MSG_NOSIGNAL);
+		if(length < 0 && errno == EINTR)
+			continue;
+		if(length < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+			client.isBroken = true;
+		if(length <= 0)
+			break;
+		sent += length;
+	}
+	client.output.erase(0, sent);
+}
+
+
+
+// Queue a line of text to be sent to a client, and try to send it.
+void Server::Queue(Client &client, string_view line)
+{
+	if(client.isBroken)
+		return;
+	if(client.output.size() + line.size() > MAX_OUTPUT)
+	{
+		client.isBroken = true;
+		return;
+	}
+	
+	// If nothing is waiting to be sent, the line can usually be sent right away.
+	bool isWaiting = !client.output.empty();
+	client.output.append(line.data(), line.size());
+	if(!isWaiting)
+		Write(client);
+}
@@ -0,0 +1,115 @@
+/* Server.h
+Michael Zahniser, 17 Oct 2026
+
+Class for the local socket that other programs (e.g. editor plugins) can use
+to control gorp and to read the messages it has parsed. Each request is a line
+of text naming a command, and each reply is a JSON object on a line of its own.
+Nothing here ever blocks: the socket and the connections to it are polled by
+the display's event loop, and replies that do not fit in a connection's socket
+buffer are held until the client reads them.
+*/
+
+#ifndef SERVER_H_
+#define SERVER_H_
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <poll.h>
+
+using namespace std;
+
+
+
+class Server {
+public:
+	// A command that a client has sent. The client is identified by a number
+	// that is never reused while gorp is running.
+	class Request {
+	public:
+		int client;
+		string command;
+	};
+	
+	
+public:
+	Server() = default;
+	Server(const Server &) = delete;
+	Server &operator=(const Server &) = delete;
+	// Close all the connections, and remove the socket.
+	~Server();
+	
+	// Get the path of the socket for the current directory. This is in the
+	// user's runtime directory, named after a hash of the directory's path, so
+	// each project has its own socket. Other sockets that belong to the same
+	// project can be named by adding a suffix.
+	static string SocketPath(const string &suffix = "");
+	// Start listening on the socket with the given path. If another copy of
+	// gorp is already listening on it, return false.
+	bool Listen(const string &path);
+	
+	// Close any connections that are finished, then add the file descriptors
+	// that need to be polled to the given list.
+	void Prepare(vector<pollfd> &fds);
+	// Handle the results of polling the file descriptors that Prepare() added,
+	// which must be in the same order, starting at the given one.
+	void Handle(const pollfd *fds);
+	// Get the next request that a client has sent. Return false if none are
+	// left.
+	bool NextRequest(Request &request);
+	
+	// Send a line of text to the given client. The line must end in a newline.
+	void Send(int client, string_view line);
+	// Have the given client receive everything that is broadcast from now on.
+	void Subscribe(int client);
+	// Send a line of text to every subscribed client.
+	void Broadcast(string_view line);
+	// Check if there are any subscribed clients, so that lines for them are not
+	// formatted if no one will receive them.
+	bool HasSubscribers() const;
+	
+	
+private:
+	// A connection from a client.
+	class Client {
+	public:
+		int fd;
+		int id;
+		// Text received that is not a full line yet, and text that could not be
+		// sent yet.
+		string input;
+		string output;
+		bool isSubscribed = false;
+		// Once the client has closed its end, the connection is closed as soon as
+		// all its output has been sent (unless it is subscribed). If an error
+		// occurs, it is closed right away.
+		bool isDone = false;
+		bool isBroken = false;
+	};
+	
+	
+private:
+	// Accept all the pending connections.
+	void Accept();
+	// Read whatever requests a client has sent.
+	void Read(Client &client);
+	// Send as much of a client's output as fits in its socket buffer.
+	void Write(Client &client);
+	// Queue a line of text to be sent to a client, and try to send it.
+	void Queue(Client &client, string_view line);
+	
+	
+private:
+	int fd = -1;
+	string path;
+	vector<Client> clients;
+	int nextId = 0;
+	int subscribers = 0;
+	deque<Request> requests;
+};
+
+
+
+#endif
@@ -0,0 +1,314 @@
+/* SourceCache.cpp
+Michael Zahniser, 17 Oct 2026
+*/
+
+#include "SourceCache.h"
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+	// The most files to keep in memory, which is also the most that can be waiting
+	// to be loaded at once.
+	const size_t MAX_FILES = 64;
+	// Files larger than this are probably generated, not written by hand, so
+	// they are not worth keeping in memory to preview.
+	const size_t MAX_SIZE = 64 << 20;
+	
+	// Create a pipe whose ends are non-blocking and closed on exec().
+	void CreatePipe(int fds[2])
+	{
+		if(pipe(fds))
+			return;
+		for(int i = 0; i < 2; ++i)
+		{
+			fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+			fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+		}
+	}
+	
+	// Read everything that has been written to a pipe, to reset it.
+	void Drain(int fd)
+	{
+		char buffer[256];
+		while(read(fd, buffer, sizeof(buffer)) > 0)
+			continue;
+	}
+}
+
+
+
+// Read the file with the given path, and find where its lines start.
+SourceCache::File::File(const string &path)
+	: path(path)
+{
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if(fd < 0)
+		return;
+	
+	// If the file shrinks while it is being read, only what was read is kept.
+	struct stat status;
+	if(!fstat(fd, &status) && S_ISREG(status.st_mode) && static_cast<size_t>(status.st_size) <= MAX_SIZE)
+	{
+		data.resize(status.st_size);
+		size_t size = 0;
+		isValid = true;
+		while(size < data.size())
+		{
+			ssize_t length = read(fd, &data[size], data.size() - size);
+			if(length < 0 && errno == EINTR)
+				continue;
+			isValid = (length >= 0);
+			if(length <= 0)
+				break;
+			size += length;
+		}
+		data.resize(isValid ? size : 0);
+	}
+	close(fd);
+	
+	// A last line with no line break after it is treated as if it had one.
+	offsets.push_back(0);
+	for(size_t pos = data.find('\n'); pos != string::npos; pos = data.find('\n', pos + 1))
+		offsets.push_back(pos + 1);
+	if(!data.empty() && data.back() != '\n')
+		offsets.push_back(data.size() + 1);
+}
+
+
+
+const string &SourceCache::File::Path() const
+{
+	return path;
+}
+
+
+
+// Check if the file could be read.
+bool SourceCache::File::IsValid() const
+{
+	return isValid;
+}
+
+
+
+// Get the number of lines in the file.
+int SourceCache::File::LineCount() const
+{
+	return offsets.size() - 1;
+}
+
+
+
+// Get the line with the given number (counting from 1), without its line break.
+string_view SourceCache::File::Line(int number) const
+{
+	if(number < 1 || number > LineCount())
+		return string_view();
+	
+	string_view line(data.data() + offsets[number - 1], offsets[number] - 1 - offsets[number - 1]);
+	if(!line.empty() && line.back() == '\r')
+		line.remove_suffix(1);
+	return line;
+}
+
+
+
+// Get the number of bytes of memory the file is using.
+size_t SourceCache::File::Capacity() const
+{
+	return data.capacity() + offsets.capacity() * sizeof(size_t);
+}
+
+
+
+SourceCache::SourceCache()
+	: requests(MAX_FILES), loaded(MAX_FILES)
+{
+	CreatePipe(readyPipe);
+	CreatePipe(requestPipe);
+	CreatePipe(stopPipe);
+}
+
+
+
+SourceCache::~SourceCache()
+{
+	if(loader.joinable())
+	{
+		ssize_t written = write(stopPipe[1], "", 1);
+		(void)written;
+		loader.join();
+	}
+	// Now that only this thread is running, it can free any files that were
+	// loaded but not received.
+	Request request;
+	while(loaded.Pop(request))
+		delete request.file;
+	for(int fd : {readyPipe[0], readyPipe[1], requestPipe[0], requestPipe[1], stopPipe[0], stopPipe[1]})
+		if(fd >= 0)
+			close(fd);
+}
+
+
+
+// Start loading the given file in the background, unless it is loaded or being
+// loaded already, or there is no room for it.
+void SourceCache::Prefetch(const string &path)
+{
+	if(files.size() + pending.size() < MAX_FILES && !index.count(path))
+		Load(path, false);
+}
+
+
+
+// Get the given file if it is loaded. If not, start loading it and return null.
+const SourceCache::File *SourceCache::Get(const string &path)
+{
+	unordered_map<string, list<unique_ptr<File>>::iterator>::iterator it = index.find(path);
+	if(it == index.end())
+	{
+		Load(path, true);
+		return nullptr;
+	}
+	
+	// Moving the file to the front of the list does not invalidate the
+	// iterators that point to it.
+	files.splice(files.begin(), files, it->second);
+	return files.front().get();
+}
+
+
+
+// Drop all the files, because they may have changed.
+void SourceCache::Clear()
+{
+	++generation;
+	files.clear();
+	index.clear();
+	pending.clear();
+	wanted.clear();
+}
+
+
+
+// Get the file descriptor that becomes readable when a file has been loaded.
+int SourceCache::ReadyPipe() const
+{
+	return readyPipe[0];
+}
+
+
+
+// Take in the files that the loader thread has finished loading, and return
+// true if any of them were waited for.
+bool SourceCache::Receive()
+{
+	bool isWanted = false;
+	Request request;
+	while(true)
+	{
+		// Once the queue is empty, reset the pipe, then check again in case a
+		// file was queued in between.
+		if(!loaded.Pop(request))
+		{
+			Drain(readyPipe[0]);
+			if(!loaded.Pop(request))
+				break;
+		}
+		unique_ptr<File> it(request.file);
+		--outstanding;
+		// If the cache was cleared since this file was asked for, it may be out
+		// of date, even if the same file has been asked for again since then.
+		if(request.generation != generation || !pending.erase(it->Path()))
+			continue;
+		isWanted |= wanted.erase(it->Path());
+		
+		// Make room for the new file by dropping the least recently used one.
+		if(files.size() >= MAX_FILES)
+		{
+			index.erase(files.back()->Path());
+			files.pop_back();
+		}
+		files.push_front(move(it));
+		index[files.front()->Path()] = files.begin();
+	}
+	return isWanted;
+}
+
+
+
+// Get the number of files that are loaded.
+int SourceCache::Size() const
+{
+	return files.size();
+}
+
+
+
+// Get how much memory the loaded files use.
+size_t SourceCache::Capacity() const
+{
+	size_t capacity = 0;
+	for(const unique_ptr<File> &file : files)
+		capacity += file->Capacity();
+	return capacity;
+}
+
+
+
+// Ask the loader thread to load the given file, unless it is being loaded
+// already or too many files are.
+void SourceCache::Load(const string &path, bool isWanted)
+{
+	if(!pending.count(path))
+	{
+		if(outstanding >= MAX_FILES || !requests.Push(Request{path, generation}))
+			return;
+		++outstanding;
+		pending.insert(path);
+		
+		// The loader thread is only started once it has something to do.
+		if(!loader.joinable())
+			loader = thread(&SourceCache::Run, this);
+		ssize_t written = write(requestPipe[1], "", 1);
+		(void)written;
+	}
+	if(isWanted)
+		wanted.insert(path);
+}
+
+
+
+// Load each file that is asked for until the destructor is called. This is run
+// on the loader thread.
+void SourceCache::Run()
+{
+	while(true)
+	{
+		pollfd fds[2] = {{requestPipe[0], POLLIN, 0}, {stopPipe[0], POLLIN, 0}};
+		poll(fds, 2, -1);
+		if(fds[1].revents)
+			return;
+		
+		// Reset the pipe before checking the queue, so that no request that is
+		// made in between can be missed.
+		Drain(requestPipe[0]);
+		Request request;
+		while(requests.Pop(request))
+		{
+			// There is always room in the queue, because no more files can be
+			// outstanding than it can hold.
+			request.file = new File(request.path);
+			loaded.Push(request);
+			ssize_t written = write(readyPipe[1], "", 1);
+			(void)written;
+		}
+	}
+}
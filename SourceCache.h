@@ -0,0 +1,138 @@
+/* SourceCache.h
+Michael Zahniser, 17 Oct 2026
+
+Class that keeps the source files that messages refer to in memory, so that the
+lines around a message can be shown without reading the file each time it is
+drawn. Files are read, and the start of each of their lines found, on a separate
+loader thread; the thread that draws the screen only ever uses files that are
+already loaded, so it never waits for the disk. Each file is copied rather than
+memory-mapped, because an editor may truncate a file in place while it is being
+shown, and reading a mapped page past the new end of the file would crash.
+Files are passed between the threads through lock-free queues, and the loader
+signals a file descriptor whenever a file is ready, just like the Worker does
+with its batches. Only the most recently used files are kept.
+*/
+
+#ifndef SOURCE_CACHE_H_
+#define SOURCE_CACHE_H_
+
+#include "Queue.h"
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+
+
+class SourceCache {
+public:
+	// The contents of a source file, and the offset of the start of each line.
+	class File {
+	public:
+		// Read the file with the given path, and find where its lines start.
+		explicit File(const string &path);
+		
+		const string &Path() const;
+		// Check if the file could be read.
+		bool IsValid() const;
+		// Get the number of lines, and the line with the given number (counting
+		// from 1), without its line break.
+		int LineCount() const;
+		string_view Line(int number) const;
+		// Get the number of bytes of memory the file is using.
+		size_t Capacity() const;
+		
+		
+	private:
+		string path;
+		string data;
+		bool isValid = false;
+		// The offset of the start of each line, plus one past the end.
+		vector<size_t> offsets;
+	};
+	
+	
+public:
+	SourceCache();
+	SourceCache(const SourceCache &) = delete;
+	SourceCache &operator=(const SourceCache &) = delete;
+	~SourceCache();
+	
+	// Start loading the given file in the background, if it is not loaded or
+	// being loaded already. This only loads files that fit in the cache without
+	// dropping any others, since it is only a guess which files will be used.
+	void Prefetch(const string &path);
+	// Get the given file if it is loaded. If not, start loading it, dropping
+	// the least recently used file once it is loaded if the cache is full, and
+	// return null.
+	const File *Get(const string &path);
+	// Drop all the files, because they may have changed. Any that are being
+	// loaded now are discarded once they are, even if they are asked for again,
+	// since they may have been read before the change.
+	void Clear();
+	
+	// Get the file descriptor that becomes readable when a file has been loaded.
+	// It is reset by Receive().
+	int ReadyPipe() const;
+	// Take in the files that the loader thread has finished loading, and return
+	// true if any of them were waited for, i.e. are not just prefetched.
+	bool Receive();
+	
+	// Get the number of files that are loaded, and how much memory they use.
+	int Size() const;
+	size_t Capacity() const;
+	
+	
+private:
+	// A file to load, which generation of the cache asked for it, and once it
+	// is loaded, the file itself. Clearing the cache starts a new generation.
+	class Request {
+	public:
+		string path;
+		unsigned generation = 0;
+		File *file = nullptr;
+	};
+	
+	
+private:
+	// Ask the loader thread to load the given file.
+	void Load(const string &path, bool isWanted);
+	// Load each file that is asked for until the destructor is called. This is
+	// run on the loader thread.
+	void Run();
+	
+	
+private:
+	thread loader;
+	// Files to load, and files that have been loaded.
+	Queue<Request> requests;
+	Queue<Request> loaded;
+	// The files that are loaded, most recently used first.
+	list<unique_ptr<File>> files;
+	unordered_map<string, list<unique_ptr<File>>::iterator> index;
+	// The files being loaded, and which of them are wanted right away rather
+	// than prefetched. Files that were being loaded when the cache was cleared
+	// are no longer pending, but are still counted as outstanding until they
+	// are received, since until then they take up room in the queues.
+	unordered_set<string> pending;
+	unordered_set<string> wanted;
+	size_t outstanding = 0;
+	unsigned generation = 0;
+	
+	// Pipes for waking up each thread, and for stopping the loader.
+	int readyPipe[2] = {-1, -1};
+	int requestPipe[2] = {-1, -1};
+	int stopPipe[2] = {-1, -1};
+};
+
+
+
+#endif
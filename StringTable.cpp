@@ -0,0 +1,60 @@
+/* StringTable.cpp
+Michael Zahniser, 17 Oct 2026
+*/
+
+#include "StringTable.h"
+
+using namespace std;
+
+
+
+// Get the ID of the given string, adding it to the table if necessary.
+int StringTable::Intern(string_view text)
+{
+	auto it = ids.find(text);
+	if(it != ids.end())
+		return it->second;
+	
+	// The key must refer to the stored copy, not to the caller's text.
+	string_view copy = arena.Copy(text);
+	strings.push_back(copy);
+	return ids.emplace(copy, strings.size() - 1).first->second;
+}
+
+
+
+// Get the string with the given ID.
+string_view StringTable::Get(int id) const
+{
+	return strings[id];
+}
+
+
+
+// Get the number of distinct strings in the table.
+int StringTable::Size() const
+{
+	return strings.size();
+}
+
+
+
+// Remove all strings from the table.
+void StringTable::Clear()
+{
+	ids.clear();
+	strings.clear();
+	arena.Clear();
+}
+
+
+
+// Get an estimate of the number of bytes of memory the table is using. Each
+// entry in the hash map is counted as its key and value plus a pointer to the
+// next entry and the cached hash.
+size_t StringTable::Capacity() const
+{
+	return arena.Capacity() + strings.capacity() * sizeof(string_view)
+		+ ids.bucket_count() * sizeof(void *)
+		+ ids.size() * (sizeof(pair<string_view, int>) + sizeof(void *) + sizeof(size_t));
+}
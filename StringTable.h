@@ -0,0 +1,45 @@
+/* StringTable.h
+Michael Zahniser, 17 Oct 2026
+
+Class that interns strings, so that text that is repeated many times (such as
+the path of a header file that many messages refer to) is only stored once and
+can be referred to by a small integer ID.
+*/
+
+#ifndef STRING_TABLE_H_
+#define STRING_TABLE_H_
+
+#include "Arena.h"
+
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+
+
+class StringTable {
+public:
+	// Get the ID of the given string, adding it to the table if necessary.
+	int Intern(string_view text);
+	// Get the string with the given ID.
+	string_view Get(int id) const;
+	// Get the number of distinct strings in the table.
+	int Size() const;
+	// Remove all strings from the table.
+	void Clear();
+	
+	// Get an estimate of the number of bytes of memory the table is using.
+	size_t Capacity() const;
+	
+	
+private:
+	Arena arena;
+	vector<string_view> strings;
+	unordered_map<string_view, int> ids;
+};
+
+
+
+#endif
@@ -0,0 +1,239 @@
+/* Watcher.cpp
+Michael Zahniser, 17 Oct 2026
+*/
+
+#include "Watcher.h"
+
+#include "Hash.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+	// The events to watch for. A file that is saved is either written in place
+	// or written to a temporary file and then renamed.
+	const uint32_t EVENTS = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE
+		| IN_DELETE | IN_ONLYDIR | IN_DONT_FOLLOW;
+	
+	// File extensions of source files, and names of build files.
+	const char *EXTENSIONS[] = {".c", ".cc", ".cpp", ".cxx", ".c++", ".h", ".hh", ".hpp",
+		".hxx", ".h++", ".inl", ".ipp", ".tpp", ".txx", ".s", ".S", ".cmake", ".mk"};
+	const char *BUILD_FILES[] = {"makefile", "Makefile", "GNUmakefile", "CMakeLists.txt"};
+	
+	// Check if a file with the given name is one whose changes matter.
+	bool IsSource(const char *name)
+	{
+		for(const char *it : BUILD_FILES)
+			if(!strcmp(name, it))
+				return true;
+		
+		const char *extension = strrchr(name, '.');
+		if(!extension || extension == name)
+			return false;
+		for(const char *it : EXTENSIONS)
+			if(!strcmp(extension, it))
+				return true;
+		return false;
+	}
+	
+	// Check if the given directory is a CMake build directory.
+	bool IsBuildDirectory(const string &path)
+	{
+		return !access((path + "/CMakeCache.txt").c_str(), F_OK);
+	}
+	
+	// Get the canonical path of the given directory, or an empty string if it
+	// does not exist.
+	string Canonical(const string &path)
+	{
+		char buffer[PATH_MAX];
+		return (realpath(path.c_str(), buffer) ? string(buffer) : string());
+	}
+}
+
+
+
+Watcher::~Watcher()
+{
+	if(fd >= 0)
+		close(fd);
+}
+
+
+
+// Watch the given directory, and every directory inside it.
+void Watcher::WatchTree(const string &root)
+{
+	AddDirectory(root, true);
+}
+
+
+
+// Watch the directory that the given file is in.
+void Watcher::WatchFile(const string &path)
+{
+	size_t pos = path.rfind('/');
+	AddDirectory(pos == string::npos ? "." : path.substr(0, pos + !pos), false);
+}
+
+
+
+// Get the file descriptor that becomes readable when there are changes.
+int Watcher::EventFd() const
+{
+	return fd;
+}
+
+
+
+// Read all the changes that are available, without blocking.
+bool Watcher::Read()
+{
+	bool hasChanged = false;
+	alignas(inotify_event) char buffer[65536];
+	while(true)
+	{
+		ssize_t length = read(fd, buffer, sizeof(buffer));
+		if(length <= 0)
+			break;
+		
+		for(char *it = buffer; it < buffer + length; )
+		{
+			const inotify_event &event = *reinterpret_cast<inotify_event *>(it);
+			it += sizeof(inotify_event) + event.len;
+			
+			// If events were lost, assume something changed.
+			if(event.mask & IN_Q_OVERFLOW)
+				hasChanged = true;
+			if(event.mask & IN_IGNORED)
+			{
+				// The directory was deleted. It might be created again later, so
+				// forget its path as well.
+				auto dir = directories.find(event.wd);
+				if(dir != directories.end())
+				{
+					paths.erase(dir->second.path);
+					directories.erase(dir);
+				}
+				continue;
+			}
+			if(!event.len)
+				continue;
+			
+			auto dir = directories.find(event.wd);
+			if(dir == directories.end())
+				continue;
+			if(event.mask & IN_ISDIR)
+			{
+				if((event.mask & (IN_CREATE | IN_MOVED_TO)) && dir->second.isRecursive && event.name[0] != '.'
+						&& strcmp(event.name, "CMakeFiles"))
+					AddDirectory(dir->second.path + '/' + event.name, true);
+			}
+			else if(!(event.mask & IN_CREATE) && IsSource(event.name))
+				hasChanged |= HasChanged(dir->second.path + '/' + event.name,
+					event.mask & (IN_DELETE | IN_MOVED_FROM));
+		}
+	}
+	return hasChanged;
+}
+
+
+
+// Start watching the given directory. If it is recursive, also watch all the
+// directories inside it.
+void Watcher::AddDirectory(const string &path, bool isRecursive)
+{
+	if(fd < 0)
+		fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(fd < 0)
+		return;
+	
+	// Search the tree without recursion, since it may be very deep.
+	vector<string> stack(1, path);
+	while(!stack.empty())
+	{
+		string canonical = Canonical(stack.back());
+		stack.pop_back();
+		if(canonical.empty() || !paths.insert(canonical).second)
+			continue;
+		
+		// If the system's limit on watches is reached, give up.
+		int wd = inotify_add_watch(fd, canonical.c_str(), EVENTS);
+		if(wd < 0)
+		{
+			paths.erase(canonical);
+			if(errno == ENOSPC)
+				return;
+			continue;
+		}
+		directories[wd] = Directory{canonical, isRecursive};
+		if(!isRecursive)
+			continue;
+		
+		// Hidden directories (such as .git) are skipped, and so are symbolic
+		// links, which could lead outside the tree or into a loop. So are the
+		// directories that CMake builds in, since nothing in them is written by
+		// hand.
+		DIR *dir = opendir(canonical.c_str());
+		if(!dir)
+			continue;
+		while(dirent *entry = readdir(dir))
+		{
+			if(entry->d_name[0] == '.' || !strcmp(entry->d_name, "CMakeFiles"))
+				continue;
+			string child = canonical + '/' + entry->d_name;
+			// Some file systems do not say what type each entry is.
+			struct stat info;
+			if((entry->d_type == DT_DIR || (entry->d_type == DT_UNKNOWN
+					&& !lstat(child.c_str(), &info) && S_ISDIR(info.st_mode)))
+					&& !IsBuildDirectory(child))
+				stack.push_back(child);
+		}
+		closedir(dir);
+	}
+}
+
+
+
+// Check if the contents of the given source file are different from the last
+// time it changed.
+bool Watcher::HasChanged(const string &path, bool isDeleted)
+{
+	int file = (isDeleted ? -1 : open(path.c_str(), O_RDONLY | O_CLOEXEC));
+	if(file < 0)
+	{
+		hashes.erase(path);
+		return true;
+	}
+	
+	uint64_t hash = Hash(string_view());
+	char buffer[65536];
+	ssize_t length = 0;
+	while((length = read(file, buffer, sizeof(buffer))) > 0 || (length < 0 && errno == EINTR))
+		if(length > 0)
+			hash = Hash(string_view(buffer, length), hash);
+	close(file);
+	
+	// If the file could not be read, assume it changed.
+	if(length < 0)
+	{
+		hashes.erase(path);
+		return true;
+	}
+	auto it = hashes.find(path);
+	if(it != hashes.end() && it->second == hash)
+		return false;
+	hashes[path] = hash;
+	return true;
+}
@@ -0,0 +1,77 @@
+/* Watcher.h
+Michael Zahniser, 17 Oct 2026
+
+Class for watching the project's source files with inotify, so that the build
+can be restarted whenever one of them is saved. Every directory in the project
+tree is watched (except hidden ones and CMake build directories), along with the
+directories of any other files that messages refer to. Only changes to source
+files and makefiles count; anything else the build writes, such as object
+files, is ignored. So is a source file that is written with the same contents
+it had before, which is what most code generators do when rerun, so that a
+build that generates source files does not restart itself forever.
+*/
+
+#ifndef WATCHER_H_
+#define WATCHER_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+
+
+
+class Watcher {
+public:
+	Watcher() = default;
+	Watcher(const Watcher &) = delete;
+	Watcher &operator=(const Watcher &) = delete;
+	~Watcher();
+	
+	// Watch the given directory, and every directory inside it. Directories
+	// that are created inside it later are watched too.
+	void WatchTree(const string &root);
+	// Watch the directory that the given file is in.
+	void WatchFile(const string &path);
+	
+	// Get the file descriptor that becomes readable when there are changes, or
+	// -1 if nothing is being watched.
+	int EventFd() const;
+	// Read all the changes that are available, without blocking. Return true
+	// if any source file was changed, created, or deleted.
+	bool Read();
+	
+	
+private:
+	// Start watching the given directory. If it is recursive, also watch all
+	// the directories inside it.
+	void AddDirectory(const string &path, bool isRecursive);
+	// Check if the contents of the given source file are different from the
+	// last time it changed. The first time a file changes, it always counts.
+	bool HasChanged(const string &path, bool isDeleted);
+	
+	
+private:
+	// A directory that is being watched.
+	class Directory {
+	public:
+		string path;
+		bool isRecursive;
+	};
+	
+	
+private:
+	int fd = -1;
+	// The watched directories, by watch descriptor, and their canonical paths,
+	// so that no directory is ever watched twice.
+	unordered_map<int, Directory> directories;
+	unordered_set<string> paths;
+	// A hash of the contents of each source file that has changed.
+	unordered_map<string, uint64_t> hashes;
+};
+
+
+
+#endif
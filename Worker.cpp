@@ -0,0 +1,283 @@
+/* Worker.cpp
+Michael Zahniser, 17 Oct 2026
+*/
+
+#include "Worker.h"
+
+#include <cerrno>
+#include <chrono>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+	// The number of batches that can be waiting to be received, and how many
+	// records the worker puts in a batch before sending it.
+	const size_t QUEUE_SIZE = 64;
+	const size_t BATCH_SIZE = 1024;
+	// While the process's output is closed but it has not exited yet, how often
+	// to check whether it has exited, in milliseconds.
+	const int EXIT_POLL_INTERVAL = 50;
+	
+	// Create a pipe whose ends are non-blocking and closed on exec().
+	void CreatePipe(int fds[2])
+	{
+		if(pipe(fds))
+			return;
+		for(int i = 0; i < 2; ++i)
+		{
+			fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+			fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+		}
+	}
+	
+	// Read everything that has been written to a pipe, to reset it.
+	void Drain(int fd)
+	{
+		char buffer[256];
+		while(read(fd, buffer, sizeof(buffer)) > 0)
+			continue;
+	}
+}
+
+
+
+Worker::Worker()
+	: ready(QUEUE_SIZE), unused(QUEUE_SIZE + 2)
+{
+	// One batch can be held by each thread, in addition to the ones in the
+	// ready queue, so this many batches ensure the worker never runs out.
+	for(size_t i = 0; i < QUEUE_SIZE + 2; ++i)
+	{
+		batches.emplace_back(new RecordBatch);
+		unused.Push(batches.back().get());
+	}
+	CreatePipe(readyPipe);
+	CreatePipe(stopPipe);
+}
+
+
+
+Worker::~Worker()
+{
+	Stop();
+	process.ReapAll();
+	for(int fd : {readyPipe[0], readyPipe[1], stopPipe[0], stopPipe[1]})
+		if(fd >= 0)
+			close(fd);
+}
+
+
+
+// Start running the given command, stopping any previous one.
+void Worker::Start(const string &command)
+{
+	Stop();
+	parser.Clear();
+	process.Start(command);
+	worker = thread(&Worker::Run, this);
+}
+
+
+
+// Replay a saved build log instead of running a command.
+void Worker::Replay(const string &log, const string &timing)
+{
+	Stop();
+	parser.Clear();
+	process.Replay(log, timing);
+	worker = thread(&Worker::Run, this);
+}
+
+
+
+// Stop the current command. Any batches that have not been received yet are
+// discarded, and any batch that has been received but not released must not be
+// used any more.
+void Worker::Stop()
+{
+	if(worker.joinable())
+	{
+		ssize_t written = write(stopPipe[1], "", 1);
+		(void)written;
+		worker.join();
+		Drain(stopPipe[0]);
+	}
+	process.Kill();
+	
+	// Now that only this thread is running, it is safe to act as both the
+	// producer and the consumer for both queues. Reset them to their initial
+	// state, with every batch unused.
+	RecordBatch *batch;
+	while(ready.Pop(batch))
+		continue;
+	while(unused.Pop(batch))
+		continue;
+	for(const unique_ptr<RecordBatch> &it : batches)
+	{
+		it->Clear();
+		unused.Push(it.get());
+	}
+	current = nullptr;
+	Drain(readyPipe[0]);
+}
+
+
+
+// Check on any processes from previous builds that have been killed but not
+// yet exited.
+int Worker::Reap()
+{
+	return process.Reap();
+}
+
+
+
+// Get the file descriptor that becomes readable when a batch is ready.
+int Worker::ReadyPipe() const
+{
+	return readyPipe[0];
+}
+
+
+
+// Get the next batch of records, or null if none are ready.
+RecordBatch *Worker::Receive()
+{
+	RecordBatch *batch = nullptr;
+	if(ready.Pop(batch))
+		return batch;
+	
+	// Reset the pipe, then check again in case a batch was queued in between.
+	Drain(readyPipe[0]);
+	return (ready.Pop(batch) ? batch : nullptr);
+}
+
+
+
+// Once all the records in a batch are handled, pass it back to be reused.
+void Worker::Release(RecordBatch *batch)
+{
+	batch->Clear();
+	unused.Push(batch);
+}
+
+
+
+// Get statistics about the work the worker has done.
+const Worker::Stats &Worker::GetStats() const
+{
+	return stats;
+}
+
+
+
+// Read and parse the output of the process until it is done or Stop() is
+// called. This is run on the worker thread.
+void Worker::Run()
+{
+	unused.Pop(current);
+	while(true)
+	{
+		// Wait for more output. Once both pipes have closed, all that is left is
+		// to wait for the process to exit.
+		bool isClosed = (process.OutputPipe() < 0 && process.ErrorPipe() < 0);
+		pollfd fds[3] = {
+			{stopPipe[0], POLLIN, 0},
+			{process.OutputPipe(), POLLIN, 0},
+			{process.ErrorPipe(), POLLIN, 0}
+		};
+		if(poll(fds, 3, isClosed ? EXIT_POLL_INTERVAL : -1) < 0 && errno != EINTR)
+			return;
+		if(fds[0].revents)
+			return;
+		process.Poll(fds[1].revents, fds[2].revents);
+		
+		// Parse every full line that has been received. If the compiler prints
+		// its diagnostics as JSON, parse that text as it arrives instead.
+		string_view text;
+		uint64_t lines = 0;
+		uint64_t bytes = 0;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		while(true)
+		{
+			if(process.PeekError(text) && (parser.IsReadingJson() || parser.IsJson(text)))
+			{
+				size_t count = parser.ParseJson(text, *current);
+				process.ConsumeError(count);
+				bytes += count;
+			}
+			else
+			{
+				if(process.ReadError(text))
+					parser.ParseError(text, *current);
+				else if(process.ReadOutput(text))
+					parser.ParseOutput(text, *current);
+				else
+					break;
+				++lines;
+				bytes += text.size() + 1;
+			}
+			
+			// Publishing may have to wait, which should not count as parse time.
+			if(current->Size() >= BATCH_SIZE)
+			{
+				stats.parseTime += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+				if(!Publish())
+					return;
+				start = chrono::steady_clock::now();
+			}
+		}
+		stats.parseTime += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+		stats.lines += lines;
+		stats.bytes += bytes;
+		stats.buffered = process.Buffered();
+		stats.bufferCapacity = process.BufferCapacity();
+		
+		// Once the process is done, send a record saying so.
+		bool isDone = process.IsDone();
+		if(isDone)
+		{
+			Record &record = current->Add(string_view(), false);
+			record.action = Record::DONE;
+			record.exitStatus = process.ExitStatus();
+		}
+		if(!current->IsEmpty() && !Publish())
+			return;
+		if(isDone)
+			return;
+	}
+}
+
+
+
+// Send the current batch to the receiving thread. If the queue is full, wait
+// for there to be room. Return false if Stop() is called while waiting.
+bool Worker::Publish()
+{
+	while(!ready.Push(current))
+		if(IsStopping(1))
+			return false;
+	
+	// Let the other thread know there is a batch ready. If the pipe is full, it
+	// is already readable, so there is no need to check whether this succeeded.
+	ssize_t written = write(readyPipe[1], "", 1);
+	(void)written;
+	
+	// There is always an unused batch at this point, because this thread holds
+	// none, the other holds at most one, and the rest fit in the ready queue.
+	unused.Pop(current);
+	return true;
+}
+
+
+
+// Check if Stop() has been called, waiting up to the given timeout.
+bool Worker::IsStopping(int timeout) const
+{
+	pollfd fd = {stopPipe[0], POLLIN, 0};
+	return poll(&fd, 1, timeout) > 0;
+}
@@ -0,0 +1,114 @@
+/* Worker.h
+Michael Zahniser, 17 Oct 2026
+
+Class that runs a build command and reads and parses its output on a separate
+thread, so that the thread that handles input and draws the screen never has to
+wait for that work. Parsed output is passed back in batches of records through
+a lock-free queue, and the worker signals a file descriptor whenever it has
+queued up a new batch, so the other thread can wait for it with poll().
+*/
+
+#ifndef WORKER_H_
+#define WORKER_H_
+
+#include "Parser.h"
+#include "Process.h"
+#include "Queue.h"
+#include "Record.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+
+class Worker {
+public:
+	// Statistics about the work done by the worker thread, since the program
+	// started. These can be read by any thread.
+	class Stats {
+	public:
+		// How many lines and bytes of output have been parsed, and how long that
+		// took, in nanoseconds.
+		atomic<uint64_t> lines{0};
+		atomic<uint64_t> bytes{0};
+		atomic<uint64_t> parseTime{0};
+		// How many bytes of output were waiting to be parsed after the last read,
+		// and how much memory was allocated to hold them.
+		atomic<uint64_t> buffered{0};
+		atomic<uint64_t> bufferCapacity{0};
+	};
+	
+	
+public:
+	Worker();
+	Worker(const Worker &) = delete;
+	Worker &operator=(const Worker &) = delete;
+	~Worker();
+	
+	// Start running the given command, stopping any previous one.
+	void Start(const string &command);
+	// Replay a saved build log instead of running a command. See Process.
+	void Replay(const string &log, const string &timing);
+	// Stop the current command. Any batches that have not been received yet are
+	// discarded, and any batch that has been received but not released must not
+	// be used any more.
+	void Stop();
+	// Check on any processes from previous builds that have been killed but
+	// not yet exited. This returns the time until it next needs to be called
+	// (in milliseconds), or -1 if there are none. See Process::Reap().
+	int Reap();
+	
+	// Get the file descriptor that becomes readable when a batch is ready. It is
+	// reset by Receive(), so it should be polled again once that returns null.
+	int ReadyPipe() const;
+	// Get the next batch of records, or null if none are ready. The last record
+	// of the last batch has the DONE action.
+	RecordBatch *Receive();
+	// Once all the records in a batch are handled, pass it back to be reused.
+	void Release(RecordBatch *batch);
+	
+	// Get statistics about the work the worker has done.
+	const Stats &GetStats() const;
+	
+	
+private:
+	// Read and parse the output of the process until it is done or Stop() is
+	// called. This is run on the worker thread.
+	void Run();
+	// Send the current batch to the receiving thread. If the queue is full, wait
+	// for there to be room. Return false if Stop() is called while waiting.
+	bool Publish();
+	// Check if Stop() has been called, waiting up to the given timeout.
+	bool IsStopping(int timeout) const;
+	
+	
+private:
+	Process process;
+	Parser parser;
+	thread worker;
+	
+	// All the batches, and queues of batches that are ready to be handled and
+	// batches that are ready to be reused. Each one is either in a queue or held
+	// by one of the threads.
+	vector<unique_ptr<RecordBatch>> batches;
+	Queue<RecordBatch *> ready;
+	Queue<RecordBatch *> unused;
+	// The batch the worker is currently filling.
+	RecordBatch *current = nullptr;
+	
+	Stats stats;
+	
+	// Pipes for waking up each thread.
+	int readyPipe[2] = {-1, -1};
+	int stopPipe[2] = {-1, -1};
+};
+
+
+
+#endif
@@ -0,0 +1,152 @@
+/* Generator.cpp
+Michael Zahniser, 17 Oct 2026
+*/
+
+#include "Generator.h"
+
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace {
+	// Get the path of the source file with the given index.
+	string Source(int file)
+	{
+		return "src/module" + to_string(file / 20) + "/File" + to_string(file) + ".cpp";
+	}
+	
+	// Add a source excerpt, in the format GCC has used since version 9.
+	void AddExcerpt(string &text, int line, int column)
+	{
+		string number = to_string(line);
+		text += string(number.size() < 5 ? 5 - number.size() : 0, ' ') + number + " |     value = compute(index, total);\n";
+		text += "      | " + string(column > 1 ? column - 1 : 0, ' ') + "^~~~~\n";
+	}
+}
+
+
+
+// Set one of the options, given its name and value.
+bool Generator::SetOption(const string &name, const char *value)
+{
+	int number = atoi(value);
+	if(name == "--errors")
+		errors = number;
+	else if(name == "--warnings")
+		warnings = number;
+	else if(name == "--templates")
+		templates = number;
+	else if(name == "--link-errors")
+		linkErrors = number;
+	else if(name == "--depth")
+		depth = number;
+	else if(name == "--files")
+		files = max(1, number);
+	else if(name == "--jobs")
+		jobs = max(1, number);
+	else if(name == "--seed")
+		seed = number;
+	else
+		return false;
+	return true;
+}
+
+
+
+// Get a description of the options.
+string Generator::Options() const
+{
+	return "errors=" + to_string(errors) + " warnings=" + to_string(warnings)
+		+ " templates=" + to_string(templates) + " link-errors=" + to_string(linkErrors)
+		+ " depth=" + to_string(depth) + " files=" + to_string(files)
+		+ " jobs=" + to_string(jobs) + " seed=" + to_string(seed);
+}
+
+
+
+// Generate the log.
+string Generator::Generate() const
+{
+	// A specific generator is used, rather than rand(), so the output is the
+	// same on every system.
+	mt19937 random(seed);
+	
+	// First, generate the output of each file separately, as a list of blocks
+	// that are each printed all at once.
+	vector<vector<string>> blocks(files);
+	int total = errors + warnings + templates;
+	for(int i = 0; i < total; ++i)
+	{
+		int file = random() % files;
+		string path = Source(file);
+		int line = 1 + random() % 2000;
+		int column = 1 + random() % 40;
+		string position = path + ':' + to_string(line) + ':' + to_string(column);
+		
+		string text;
+		if(random() % 4 == 0)
+			text += path + ": In function 'int function" + to_string(i) + "(int)':\n";
+		if(i < errors)
+			text += position + ": error: 'value" + to_string(i) + "' was not declared in this scope\n";
+		else if(i < errors + warnings)
+			text += position + ": warning: unused variable 'value" + to_string(i) + "' [-Wunused-variable]\n";
+		else
+		{
+			// A template backtrace starts with where the instantiation came from,
+			// and ends with a note for each candidate that was considered.
+			string header = "include/Container" + to_string(i % 50) + ".h";
+			text += "In file included from " + path + ":3:\n";
+			text += header + ": In instantiation of 'struct Container<Item" + to_string(i) + ">':\n";
+			for(int level = 1; level < depth; ++level)
+				text += header + ':' + to_string(10 * level) + ":7:   required from 'struct Level" + to_string(level) + "<Item" + to_string(i) + ">'\n";
+			text += position + ":   required from here\n";
+			text += header + ":42:9: error: no type named 'type' in 'struct Traits<Item" + to_string(i) + ">'\n";
+			AddExcerpt(text, 42, 9);
+			for(int note = 0; note < 2; ++note)
+				text += header + ':' + to_string(50 + note) + ":5: note: candidate: 'template<class T> void Container<T>::Insert(T)'\n";
+			blocks[file].push_back(text);
+			continue;
+		}
+		AddExcerpt(text, line, column);
+		blocks[file].push_back(text);
+	}
+	
+	// Now, compile the files with the given number of jobs. Each time, one of the
+	// files being compiled prints its next block, and once it is done, the next
+	// file takes its place.
+	string log;
+	vector<pair<int, size_t>> active;
+	int next = 0;
+	while(next < files || !active.empty())
+	{
+		while(static_cast<int>(active.size()) < jobs && next < files)
+		{
+			log += "g++ -Wall -O2 -c " + Source(next) + " -o obj/File" + to_string(next) + ".o\n";
+			active.emplace_back(next++, 0);
+		}
+		size_t index = random() % active.size();
+		pair<int, size_t> &it = active[index];
+		if(it.second < blocks[it.first].size())
+			log += blocks[it.first][it.second++];
+		if(it.second >= blocks[it.first].size())
+		{
+			active[index] = active.back();
+			active.pop_back();
+		}
+	}
+	
+	// Finally, link everything.
+	log += "g++ -o program obj/*.o\n";
+	for(int i = 0; i < linkErrors; ++i)
+	{
+		int file = random() % files;
+		if(i % 10 == 0)
+			log += "/usr/bin/ld: obj/File" + to_string(file) + ".o: in function `function" + to_string(i) + "(int)':\n";
+		log += Source(file) + ":(.text+0x" + to_string(16 * i) + "): undefined reference to `missing" + to_string(i) + "()'\n";
+	}
+	if(linkErrors)
+		log += "collect2: error: ld returned 1 exit status\n";
+	return log;
+}
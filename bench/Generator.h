@@ -0,0 +1,48 @@
+/* Generator.h
+Michael Zahniser, 17 Oct 2026
+
+Class for generating synthetic build output, for benchmarks that need a log of
+a particular size or shape. The output imitates GCC: compiler commands, errors
+and warnings with source excerpts, template instantiation backtraces, and link
+errors, with the output of several source files interleaved as in a parallel
+build. The same options and seed always produce the same log.
+*/
+
+#ifndef GENERATOR_H_
+#define GENERATOR_H_
+
+#include <string>
+
+using namespace std;
+
+
+
+class Generator {
+public:
+	// Set one of the options below, given its name (e.g. "--errors") and value.
+	// If the name is not recognized, this returns false.
+	bool SetOption(const string &name, const char *value);
+	// Get a description of the options, in the form "name=value ...".
+	string Options() const;
+	
+	// Generate the log.
+	string Generate() const;
+	
+	
+public:
+	int errors = 2000;
+	int warnings = 20000;
+	int templates = 500;
+	int linkErrors = 200;
+	// How deep each template backtrace is.
+	int depth = 6;
+	// How many source files the messages are spread over, and how many of them
+	// are compiled at once.
+	int files = 400;
+	int jobs = 8;
+	unsigned seed = 1;
+};
+
+
+
+#endif
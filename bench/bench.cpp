@@ -0,0 +1,492 @@
+/* bench.cpp
+Michael Zahniser, 17 Oct 2026
+
+Benchmarks for the parts of gorp that process build output. Each benchmark is
+run on a captured or generated build log, and prints one line in this format,
+so that the results can be compared between commits with diff:
+  <name> <rate> <unit>/s <rate> MB/s <count> <unit>
+Usage:
+  gorp-bench suite [<log file> | <generator options>]
+  gorp-bench generate [<generator options>]
+  gorp-bench classify <log file>
+  gorp-bench structured <log file>
+The generator options are --errors, --warnings, --templates, --link-errors,
+--depth, --files, --jobs, and --seed, each followed by a number.
+*/
+
+#include "Generator.h"
+
+#include "../Diagnostic.h"
+#include "../Filter.h"
+#include "../LineBuffer.h"
+#include "../LineCounts.h"
+#include "../MessageList.h"
+#include "../Parser.h"
+#include "../Record.h"
+#include "../SearchIndex.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+	// A build log, memory-mapped so that even a very large one can be used
+	// without first reading it all into memory.
+	class Log {
+	public:
+		explicit Log(const char *path)
+		{
+			int fd = open(path, O_RDONLY);
+			struct stat info;
+			if(fd < 0 || fstat(fd, &info) || !info.st_size)
+			{
+				if(fd >= 0)
+					close(fd);
+				return;
+			}
+			void *result = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			close(fd);
+			if(result == MAP_FAILED)
+				return;
+			text = string_view(static_cast<const char *>(result), info.st_size);
+		}
+		~Log()
+		{
+			if(!text.empty())
+				munmap(const_cast<char *>(text.data()), text.size());
+		}
+		
+		// Call the given function for each line of the log.
+		template <class F>
+		size_t ForEachLine(F f) const
+		{
+			size_t count = 0;
+			const char *it = text.data();
+			const char *end = it + text.size();
+			while(it < end)
+			{
+				const char *next = static_cast<const char *>(memchr(it, '\n', end - it));
+				if(!next)
+					next = end;
+				f(string_view(it, next - it));
+				it = next + 1;
+				++count;
+			}
+			return count;
+		}
+		
+		string_view text;
+	};
+	
+	
+	// The number of rows of the screen, for the scrolling benchmarks.
+	const int ROWS = 50;
+	
+	
+	// Print the results of a benchmark that handled the given number of items,
+	// and the given number of bytes of text, in the given time.
+	void Report(const char *name, size_t count, const char *unit, size_t size, double seconds)
+	{
+		printf("%-24s %14.0f %5s/s %10.1f MB/s %12zu %s\n", name,
+			count / seconds, unit, size / seconds / 1e6, count, unit);
+	}
+	
+	
+	// Get how many seconds have passed since the given time.
+	double Since(chrono::steady_clock::time_point start)
+	{
+		return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	}
+	
+	
+	// Time how long it takes to call the given function on each line of the
+	// log, and print the results.
+	template <class F>
+	void Time(const char *name, const Log &log, F f)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		size_t count = log.ForEachLine(f);
+		Report(name, count, "lines", log.text.size(), Since(start));
+	}
+	
+	
+	// The classifier that gorp used before Diagnostic, for comparison: one
+	// search of the line per tag, then another pass for the position.
+	Message::Type OldClassify(string_view text, int &line, int &column)
+	{
+		Message::Type type = Message::NONE;
+		if(text.find(": error: ld returned") != string::npos)
+			type = Message::NONE;
+		else if(text.find(": undefined reference") != string::npos)
+			type = Message::LINK;
+		else if(text.find(": error: ") != string::npos)
+			type = Message::ERROR;
+		else if(text.find(": warning: ") != string::npos)
+			type = Message::WARNING;
+		
+		if(type != Message::NONE && type != Message::LINK)
+		{
+			string copy(text);
+			size_t pos = copy.find(':');
+			line = atol(copy.data() + pos + 1);
+			pos = copy.find(':', pos + 1);
+			if(pos != string::npos)
+				column = atol(copy.data() + pos + 1);
+		}
+		return type;
+	}
+	
+	
+	int Classify(const char *path)
+	{
+		Log log(path);
+		if(log.text.empty())
+		{
+			fprintf(stderr, "Unable to read \"%s\".\n", path);
+			return 1;
+		}
+		
+		// Read through the whole log once first, so that the first benchmark
+		// is not the only one that has to wait for the log to be paged in.
+		log.ForEachLine([](string_view) {});
+		
+		// The counts are printed so that the work cannot be optimized away, and
+		// so that it is possible to check that both classifiers agree.
+		size_t counts[2][4] = {};
+		int line = 0;
+		int column = 0;
+		Time("classify.old", log, [&](string_view text)
+		{
+			++counts[0][OldClassify(text, line, column)];
+		});
+		Diagnostic diagnostic;
+		Time("classify.diagnostic", log, [&](string_view text)
+		{
+			diagnostic.Parse(text);
+			++counts[1][diagnostic.type];
+		});
+		for(const size_t *count : counts)
+			printf("%-24s %zu errors, %zu warnings, %zu link errors\n", (count == counts[0] ? "counts.old" : "counts.diagnostic"),
+				count[Message::ERROR], count[Message::WARNING], count[Message::LINK]);
+		return 0;
+	}
+	
+	
+	// Add a string to a JSON document, in quotes and with any special
+	// characters escaped.
+	void AppendJson(string &json, string_view text)
+	{
+		json += '"';
+		for(char c : text)
+		{
+			if(c == '"' || c == '\\')
+				json += '\\';
+			json += c;
+		}
+		json += '"';
+	}
+	
+	
+	// Compare parsing the diagnostics in a log as text with parsing the same
+	// diagnostics as GCC's JSON output. The JSON is generated from the log, with
+	// one document for every hundred diagnostics, as if each came from a
+	// different source file.
+	int Structured(const char *path)
+	{
+		Log log(path);
+		if(log.text.empty())
+		{
+			fprintf(stderr, "Unable to read \"%s\".\n", path);
+			return 1;
+		}
+		
+		string json;
+		size_t documentSize = 0;
+		Diagnostic diagnostic;
+		log.ForEachLine([&](string_view text)
+		{
+			if(!diagnostic.Parse(text) || diagnostic.type == Message::LINK)
+				return;
+			json += (documentSize ? ", " : "[");
+			json += (diagnostic.type == Message::ERROR ? "{\"kind\": \"error\", " : "{\"kind\": \"warning\", ");
+			string position = ", \"line\": " + to_string(diagnostic.line) + ", \"column\": " + to_string(diagnostic.column) + "}";
+			json += "\"locations\": [{\"caret\": {\"file\": ";
+			AppendJson(json, diagnostic.file);
+			json += position + ", \"finish\": {\"file\": ";
+			AppendJson(json, diagnostic.file);
+			json += position + "}], \"message\": ";
+			AppendJson(json, diagnostic.body);
+			json += ", \"children\": []}";
+			if(++documentSize == 100)
+			{
+				json += "]\n";
+				documentSize = 0;
+			}
+		});
+		if(documentSize)
+			json += "]\n";
+		
+		// Both parsers fill batches of records, just as the worker thread does.
+		RecordBatch batch;
+		size_t counts[2] = {};
+		for(int pass = 0; pass < 2; ++pass)
+		{
+			Parser parser;
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			if(!pass)
+				log.ForEachLine([&](string_view text)
+				{
+					parser.ParseError(text, batch);
+					if(batch.Size() >= 1024)
+					{
+						for(size_t i = 0; i < batch.Size(); ++i)
+							counts[0] += (batch[i].action == Record::MESSAGE);
+						batch.Clear();
+					}
+				});
+			else
+			{
+				// Feed the JSON in pieces the size of a pipe's buffer.
+				string_view text = json;
+				while(!text.empty())
+				{
+					string_view chunk = text.substr(0, 65536);
+					text.remove_prefix(chunk.size());
+					while(!chunk.empty())
+						chunk.remove_prefix(parser.ParseJson(chunk, batch));
+					for(size_t i = 0; i < batch.Size(); ++i)
+						counts[1] += (batch[i].action == Record::MESSAGE);
+					batch.Clear();
+				}
+			}
+			for(size_t i = 0; i < batch.Size(); ++i)
+				counts[pass] += (batch[i].action == Record::MESSAGE);
+			batch.Clear();
+			
+			Report(pass ? "structured.json" : "structured.text", counts[pass], "msgs", pass ? json.size() : log.text.size(), Since(start));
+		}
+		return 0;
+	}
+	
+	
+	// Read the generator options from the command line. If an argument is not
+	// an option, it is returned as the path of a log file to use instead.
+	bool ReadOptions(int argc, char *argv[], Generator &generator, const char *&path)
+	{
+		for(int i = 2; i < argc; ++i)
+		{
+			if(i + 1 < argc && generator.SetOption(argv[i], argv[i + 1]))
+				++i;
+			else if(!path && argv[i][0] != '-')
+				path = argv[i];
+			else
+				return false;
+		}
+		return true;
+	}
+	
+	
+	// Run every benchmark of the steps gorp takes to go from the output of a
+	// build to a screen full of messages, in the order it takes them.
+	int Suite(const char *path, const Generator &generator)
+	{
+		// A generated log is written to a temporary file, so that it can be read
+		// in the same way as a real one.
+		char tempPath[] = "/tmp/gorp-bench-XXXXXX";
+		if(!path)
+		{
+			int fd = mkstemp(tempPath);
+			string text = generator.Generate();
+			if(fd < 0 || write(fd, text.data(), text.size()) != static_cast<ssize_t>(text.size()))
+			{
+				fprintf(stderr, "Unable to write \"%s\".\n", tempPath);
+				return 1;
+			}
+			close(fd);
+			path = tempPath;
+			printf("# %s\n", generator.Options().c_str());
+		}
+		Log log(path);
+		int fd = open(path, O_RDONLY);
+		if(path == tempPath)
+			unlink(tempPath);
+		if(log.text.empty() || fd < 0)
+		{
+			fprintf(stderr, "Unable to read \"%s\".\n", path);
+			return 1;
+		}
+		log.ForEachLine([](string_view) {});
+		
+		// Splitting the output into lines, as Process does with each pipe.
+		{
+			LineBuffer buffer;
+			string_view line;
+			size_t count = 0;
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			while(buffer.ReadFrom(fd) > 0)
+				while(buffer.NextLine(line))
+					++count;
+			buffer.Finish();
+			while(buffer.NextLine(line))
+				++count;
+			Report("split.linebuffer", count, "lines", log.text.size(), Since(start));
+			close(fd);
+		}
+		
+		// Classifying each line.
+		Diagnostic diagnostic;
+		size_t types[4] = {};
+		Time("classify.diagnostic", log, [&](string_view text)
+		{
+			diagnostic.Parse(text);
+			++types[diagnostic.type];
+		});
+		
+		// Parsing the lines into records, as the worker thread does, and then
+		// building the messages from them, as Display does. The two steps are
+		// timed separately, one batch at a time.
+		Parser parser;
+		RecordBatch batch;
+		MessageList messages;
+		LineCounts lineCounts;
+		double parseTime = 0.;
+		double buildTime = 0.;
+		size_t records = 0;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		auto Build = [&]()
+		{
+			chrono::steady_clock::time_point built = chrono::steady_clock::now();
+			parseTime += chrono::duration<double>(built - start).count();
+			for(size_t i = 0; i < batch.Size(); ++i)
+			{
+				const Record &record = batch[i];
+				if(record.action == Record::MESSAGE)
+				{
+					record.GetDiagnostic(diagnostic);
+					int index = messages.Add(diagnostic, record.header);
+					lineCounts.Add(messages[index].LineCount());
+				}
+				else if(record.action == Record::TEXT || record.action == Record::BACKTRACE)
+				{
+					messages.AddText(record.index, record.text, record.depth);
+					lineCounts.Set(record.index, messages[record.index].LineCount());
+				}
+			}
+			records += batch.Size();
+			batch.Clear();
+			start = chrono::steady_clock::now();
+			buildTime += chrono::duration<double>(start - built).count();
+		};
+		log.ForEachLine([&](string_view text)
+		{
+			parser.ParseError(text, batch);
+			if(batch.Size() >= 1024)
+				Build();
+		});
+		Build();
+		Report("parse.parser", records, "lines", log.text.size(), parseTime);
+		Report("build.messagelist", records, "lines", log.text.size(), buildTime);
+		if(lineCounts.Size() < 2)
+			return 0;
+		
+		// Scrolling to random messages, and then finding which message is on each
+		// row of the screen, or which one a page up would scroll to.
+		mt19937 random(1);
+		const int SCROLLS = 200000;
+		size_t found = 0;
+		start = chrono::steady_clock::now();
+		for(int i = 0; i < SCROLLS; ++i)
+		{
+			int first = lineCounts.Sum(random() % lineCounts.Size());
+			for(int row = 0; row < ROWS; ++row)
+				found += lineCounts.Find(first + row);
+		}
+		Report("scroll.rows", SCROLLS * ROWS, "rows", 0, Since(start));
+		start = chrono::steady_clock::now();
+		for(int i = 0; i < SCROLLS; ++i)
+		{
+			int first = lineCounts.Sum(random() % lineCounts.Size()) - (ROWS - 2);
+			found += (first > 0 ? lineCounts.Find(first - 1) + 1 : 0);
+		}
+		Report("scroll.page", SCROLLS, "pages", 0, Since(start));
+		
+		// Clicking on random lines.
+		start = chrono::steady_clock::now();
+		for(int i = 0; i < SCROLLS; ++i)
+			found += lineCounts.Find(random() % lineCounts.Total());
+		Report("hittest.find", SCROLLS, "clicks", 0, Since(start));
+		
+		// Filtering the messages, as Display does each time the filter changes.
+		// One message with a very long first line is added, like the ones some
+		// code generators produce, so that matching a regular expression against
+		// it would crash if the matcher used more stack for longer text.
+		string line = "generated.cpp:1:1: error: " + string(200000, 'x') + " end";
+		diagnostic.Parse(line);
+		messages.Add(diagnostic, "generated.cpp: In function 'void f()':");
+		SearchIndex searchIndex;
+		for(int i = 0; i < messages.Size(); ++i)
+		{
+			searchIndex.Add(i, messages.Header(i));
+			searchIndex.Add(i, messages.FirstLine(i));
+		}
+		const char *QUERIES[] = {"error", "type:warn path:.cpp", "undefined reference", "x+ end$", "(struct|class) .*"};
+		Filter filter;
+		vector<bool> isHidden;
+		size_t matches = 0;
+		start = chrono::steady_clock::now();
+		for(const char *query : QUERIES)
+		{
+			filter.Set(query);
+			matches += filter.Apply(messages, searchIndex, isHidden);
+		}
+		Report("filter.apply", size(QUERIES) * messages.Size(), "msgs", 0, Since(start));
+		
+		// The counts are printed so that the work cannot be optimized away, and
+		// so that it is possible to check that the log is what was expected.
+		printf("# %d messages, %d lines, %zu errors, %zu warnings, %zu link errors, %zu matches (%zu)\n",
+			messages.Size(), lineCounts.Total(), types[Message::ERROR], types[Message::WARNING],
+			types[Message::LINK], matches, found % 10);
+		return 0;
+	}
+}
+
+
+
+int main(int argc, char *argv[])
+{
+	Generator generator;
+	const char *path = nullptr;
+	if(argc >= 2 && !strcmp(argv[1], "suite") && ReadOptions(argc, argv, generator, path))
+		return Suite(path, generator);
+	if(argc >= 2 && !strcmp(argv[1], "generate") && ReadOptions(argc, argv, generator, path) && !path)
+	{
+		string text = generator.Generate();
+		fwrite(text.data(), 1, text.size(), stdout);
+		return 0;
+	}
+	if(argc == 3 && !strcmp(argv[1], "classify"))
+		return Classify(argv[2]);
+	if(argc == 3 && !strcmp(argv[1], "structured"))
+		return Structured(argv[2]);
+	
+	fprintf(stderr, "Usage:\n");
+	fprintf(stderr, "  gorp-bench suite [<log file> | <generator options>]\n");
+	fprintf(stderr, "  gorp-bench generate [<generator options>]\n");
+	fprintf(stderr, "  gorp-bench classify <log file>\n");
+	fprintf(stderr, "  gorp-bench structured <log file>\n");
+	fprintf(stderr, "The generator options are --errors, --warnings, --templates, --link-errors,\n");
+	fprintf(stderr, "--depth, --files, --jobs, and --seed, each followed by a number.\n");
+	return 1;
+}
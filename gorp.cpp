@@ -11,6 +11,8 @@ allowing you to select any message to jump to the line causing the error.
 #include <iostream>
 #include <string>
 
+#include <unistd.h>
+
 using namespace std;
 
 void PrintVersion()
@@ -25,11 +27,27 @@ void PrintHelp()
 {
 	cout << "This program parses the output of a build command and displays any warnings or" << endl;
 	cout << "errors in the terminal. Click on a message to jump to the file that produced it." << endl;
-	cout << "You can also select messages with the up/down keys and the enter key." << endl;
+	cout << "You can also select messages with the up/down keys and the enter key. The" << endl;
+	cout << "selected message is expanded to show its notes and template backtraces." << endl;
+	cout << "Press \"p\" to preview the source code around the selected message." << endl;
+	cout << "Press \"g\" to group the messages by file, sorted by line." << endl;
+	cout << "Press \"/\" to filter the messages by type, path, or text, for example:" << endl;
+	cout << "  /type:err path:src/*.cpp undeclared" << endl;
 	cout << "Command line arguments:" << endl;
 	cout << "  -v/--version: Display the version number of the program, then exit." << endl;
 	cout << "  -h/--help: Display this help message, then exit." << endl;
 	cout << "  -c/--commands: Display the command strings, then exit." << endl;
+	cout << "  --socket: Display the path of the control socket for this directory, then exit." << endl;
+	cout << "  --batch: Run the build without the terminal interface, printing each line of" << endl;
+	cout << "    each message to STDOUT as a JSON object, one per line, followed by a summary." << endl;
+	cout << "    Repeated messages are printed each time, but only counted once as unique." << endl;
+	cout << "    The exit status is 1 if there were any errors or the build command failed," << endl;
+	cout << "    or 0 otherwise." << endl;
+	cout << "  -w/--watch: Rebuild automatically whenever a source file is saved." << endl;
+	cout << "  --stats: When exiting, print how much work gorp did and how much memory it" << endl;
+	cout << "    used. Press \"s\" to show these statistics while gorp is running." << endl;
+	cout << "  --replay <log>: Instead of running the build, replay its saved output." << endl;
+	cout << "  --timing <file>: Pace the replay using a timing file from \"script -t\"." << endl;
 	cout << endl;
 	cout << "To customize the build and clean commands, create a \".gorp\" file either in the" << endl;
 	cout << "current directory (for project-specific commands) or your home directory (to" << endl;
@@ -38,7 +56,20 @@ void PrintHelp()
 	cout << "  clean: <command>" << endl;
 	cout << "  edit: <command>" << endl;
 	cout << "The edit command should use \"FILE\", \"LINE\", and \"COLUMN\" as placeholders for the" << endl;
-	cout << "file path, line index, and column index (if supported)." << endl;
+	cout << "file path, line index, and column index (if supported). It is run directly, not" << endl;
+	cout << "through a shell. For Neovim, use \"SOCKET\" as the address to listen on, e.g.:" << endl;
+	cout << "  edit: nvim-qt -- --listen SOCKET FILE +LINE" << endl;
+	cout << "Then Neovim is only started once, and gorp tells it to open the other files." << endl;
+	cout << "The file may also include an \"fps: <number>\" line to limit how many times per" << endl;
+	cout << "second the screen is redrawn (the default is 30; 0 means no limit), and a" << endl;
+	cout << "\"diagnostics: json\" or \"diagnostics: sarif\" line to have the compiler print its" << endl;
+	cout << "messages in that format, by adding a flag to CFLAGS and CXXFLAGS. A \"watch: on\"" << endl;
+	cout << "line does the same thing as the --watch option." << endl;
+	cout << endl;
+	cout << "While gorp is running, other programs can connect to its control socket and send" << endl;
+	cout << "it commands, one per line: \"build\", \"clean\", \"cancel\", \"status\", or" << endl;
+	cout << "\"subscribe\" (to receive every message as it is parsed, as in batch mode). Each" << endl;
+	cout << "command is answered with a JSON object giving the status of the build." << endl;
 	cout << endl;
 	cout << "If no commands are given via a \".gorp\" file, the defaults are:" << endl;
 	cout << "  build: make" << endl;
@@ -53,6 +84,11 @@ int main(int argc, char *argv[])
 {
 	// Parse the command lines.
 	bool displayCommands = false;
+	bool isBatch = false;
+	bool printStats = false;
+	bool watch = false;
+	string replayLog;
+	string replayTiming;
 	for(char **it = argv + 1; *it; ++it)
 	{
 		string arg = *it;
@@ -63,6 +99,19 @@ int main(int argc, char *argv[])
 		}
 		else if(arg == "-c" || arg == "--commands")
 			displayCommands = true;
+		else if(arg == "--socket")
+		{
+			cout << Server::SocketPath() << endl;
+			return 0;
+		}
+		else if(arg == "--batch")
+			isBatch = true;
+		else if(arg == "--stats")
+			printStats = true;
+		else if(arg == "-w" || arg == "--watch")
+			watch = true;
+		else if((arg == "--replay" || arg == "--timing") && it[1])
+			(arg == "--replay" ? replayLog : replayTiming) = *++it;
 		else
 		{
 			PrintHelp();
@@ -73,9 +122,29 @@ int main(int argc, char *argv[])
 	// Initialize the display, and launch the command (unless all we're doing is
 	// parsing settings files to determine what commands to use).
 	Display display;
-	display.Init(displayCommands);
+	if(!replayLog.empty())
+	{
+		for(const string &path : {replayLog, replayTiming})
+			if(!path.empty() && access(path.c_str(), R_OK))
+			{
+				cout << "Unable to read \"" << path << "\"." << endl;
+				return 1;
+			}
+		display.SetReplay(replayLog, replayTiming);
+	}
+	if(watch)
+		display.SetWatch();
+	display.Init(displayCommands, isBatch);
 	if(displayCommands)
 		return 0;
+	if(isBatch)
+	{
+		// In batch mode, STDOUT is reserved for the messages.
+		int status = display.Batch();
+		if(printStats)
+			display.PrintStats(cerr);
+		return status;
+	}
 	
 	// Run the program.
 	while(display.Update())
@@ -83,6 +152,8 @@ int main(int argc, char *argv[])
 	
 	// Clean up the terminal.
 	display.Cleanup();
+	if(printStats)
+		display.PrintStats(cout);
 	
 	return 0;
 }